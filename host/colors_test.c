@@ -0,0 +1,82 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "colors.h"
+
+/* Tag used for console messages */
+static const char *TAG = "colors_test";
+
+/**
+ * @brief Conversion of the firmware before the palette table, the reference of the test
+ */
+static rgb_color_t reference_color_to_rgb(color_e color)
+{
+    switch (color)
+    {
+    case color_RED:
+        return (rgb_color_t){.color_rgb.red = 255, .color_rgb.green = 0, .color_rgb.blue = 0};
+
+    case color_GREEN:
+        return (rgb_color_t){.color_rgb.red = 0, .color_rgb.green = 255, .color_rgb.blue = 0};
+
+    case color_BLUE:
+        return (rgb_color_t){.color_rgb.red = 0, .color_rgb.green = 0, .color_rgb.blue = 255};
+
+    case color_WARM_WHITE:
+        return (rgb_color_t){.color_rgb.red = 253, .color_rgb.green = 227, .color_rgb.blue = 108};
+
+    case color_WHITE:
+    default:
+        return (rgb_color_t){.color_rgb.red = 255, .color_rgb.green = 255, .color_rgb.blue = 255};
+    }
+}
+
+/**
+ * @brief Compares the palette conversion of one color with the reference
+ *
+ * @return true if they are equal
+ */
+static bool check_color(int color)
+{
+    rgb_color_t got = color_to_rgb_struct((color_e)color);
+    rgb_color_t want = reference_color_to_rgb((color_e)color);
+    if (got.color_rgb.red != want.color_rgb.red || got.color_rgb.green != want.color_rgb.green ||
+        got.color_rgb.blue != want.color_rgb.blue)
+    {
+        ESP_LOGE(TAG, "color %d: got %02X%02X%02X, want %02X%02X%02X", color, got.color_rgb.red,
+                 got.color_rgb.green, got.color_rgb.blue, want.color_rgb.red, want.color_rgb.green,
+                 want.color_rgb.blue);
+        return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    for (int color = 0; color < color_COUNT; ++color)
+    {
+        ok &= check_color(color);
+    }
+
+    /* Out of range colors fall back to white */
+    static const int out_of_range[] = {color_COUNT, color_COUNT + 1, 255, -1};
+    for (size_t i = 0; i < sizeof(out_of_range) / sizeof(out_of_range[0]); ++i)
+    {
+        ok &= check_color(out_of_range[i]);
+    }
+
+    /* Wire order is GRB */
+    rgb_color_t red = color_to_rgb_struct(color_RED);
+    if (red.color[0] != 0 || red.color[1] != 255 || red.color[2] != 0)
+    {
+        ESP_LOGE(TAG, "red is not stored in GRB order: %02X %02X %02X", red.color[0], red.color[1], red.color[2]);
+        ok = false;
+    }
+
+    ESP_LOGI(TAG, "%s", ok ? "passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
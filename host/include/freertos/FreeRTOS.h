@@ -0,0 +1,11 @@
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+/* Minimal subset of FreeRTOS.h, the types of the ws2812_api.h declarations */
+
+typedef long BaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+
+#endif /* HOST_FREERTOS_H_ */
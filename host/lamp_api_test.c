@@ -0,0 +1,233 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "lamp_api.h"
+#include "ws2812_api.h"
+
+/* Tag used for console messages */
+static const char *TAG = "lamp_api_test";
+
+/* Channels of the fake lamp */
+#define TEST_CHANNEL_COUNT 2
+
+/**
+ * @brief Request of the fake HTTP server and the reply of the handler
+ */
+typedef struct
+{
+    const char *content_type;
+    const char *channel; /* lamp-channel header, NULL if not sent */
+    const char *start;   /* lamp-start header, NULL if not sent */
+    const char *body;
+    size_t received;
+    int error;          /* httpd_err_code_t of httpd_resp_send_err(), -1 if none */
+    const char *status; /* Status of a reply sent without error */
+} test_request_t;
+
+/**
+ * @brief Batch the handler queued
+ */
+typedef struct
+{
+    uint32_t calls;
+    uint32_t count;
+    ws2812_command_t first;
+    rgb_color_t first_pixel, last_pixel;
+} test_batch_t;
+
+static test_request_t s_request;
+static test_batch_t s_sent;
+static esp_err_t (*s_handler)(httpd_req_t *r) = NULL;
+static char s_body[2 * LAMP_API_MAX_BODY];
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    s_handler = uri_handler->handler;
+    return ESP_OK;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    size_t len = r->content_len - s_request.received;
+    len = len < buf_len ? len : buf_len;
+    memcpy(buf, s_request.body + s_request.received, len);
+    s_request.received += len;
+    return (int)len;
+}
+
+static const char *test_header(const char *field)
+{
+    if (strcmp(field, "Content-Type") == 0)
+    {
+        return s_request.content_type;
+    }
+    if (strcmp(field, "lamp-channel") == 0)
+    {
+        return s_request.channel;
+    }
+    return strcmp(field, "lamp-start") == 0 ? s_request.start : NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    const char *value = test_header(field);
+    return value != NULL ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    const char *value = test_header(field);
+    if (value == NULL || strlen(value) >= val_size)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    strcpy(val, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    s_request.status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    s_request.error = error;
+    return ESP_OK;
+}
+
+uint8_t ws2812_get_channel_count()
+{
+    return TEST_CHANNEL_COUNT;
+}
+
+esp_err_t ws2812_send_batch(const ws2812_command_t *cmds, uint32_t count, const rgb_color_t *pixels)
+{
+    ++s_sent.calls;
+    s_sent.count = count;
+    s_sent.first = cmds[0];
+
+    /* Pixel commands take their colors one after the other from the pool */
+    uint32_t pixel_count = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        pixel_count += cmds[i].type == WS2812_CMD_PIXELS ? cmds[i].pixels.count : 0;
+    }
+    if (pixel_count > 0)
+    {
+        s_sent.first_pixel = pixels[0];
+        s_sent.last_pixel = pixels[pixel_count - 1];
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Posts a request to /api/lamp
+ *
+ * @return true if the handler accepted it and queued one batch
+ */
+static bool test_post(const char *content_type, const char *channel, const char *start, const char *body, size_t len)
+{
+    s_request = (test_request_t){
+        .content_type = content_type, .channel = channel, .start = start, .body = body, .error = -1};
+    memset(&s_sent, 0, sizeof(s_sent));
+    httpd_req_t req = {.content_len = len};
+    s_handler(&req);
+    return s_request.error == -1 && s_sent.calls == 1;
+}
+
+/**
+ * @brief Posts a binary body of count pixels, pixel i has the color (i, i >> 8, 0x5A)
+ */
+static bool test_post_binary(const char *start, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        s_body[3 * i] = (char)i;
+        s_body[3 * i + 1] = (char)(i >> 8);
+        s_body[3 * i + 2] = 0x5A;
+    }
+    return test_post("application/octet-stream", "0", start, s_body, 3 * count);
+}
+
+static bool test_expect(bool ok, const char *name)
+{
+    if (!ok)
+    {
+        ESP_LOGE(TAG, "%s", name);
+    }
+    return ok;
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    lamp_api_register_handlers(NULL);
+    if (s_handler == NULL)
+    {
+        ESP_LOGE(TAG, "no handler registered");
+        return EXIT_FAILURE;
+    }
+
+    /* The longest body the handler takes holds more pixels than a strip, they must not reach past the pool */
+    ok &= test_expect(!test_post_binary(NULL, (LAMP_API_MAX_BODY - 1) / 3) && s_request.error == HTTPD_400_BAD_REQUEST,
+                      "oversized binary body accepted");
+    ok &= test_expect(!test_post_binary("1000", 30), "binary body past the strip end accepted");
+    ok &= test_expect(!test_post_binary(NULL, 0), "empty binary body accepted");
+
+    /* A whole strip, and the last pixels of it */
+    ok &= test_expect(test_post_binary(NULL, WS2812_MAX_LED_COUNT) && s_sent.count == 1 &&
+                          s_sent.first.type == WS2812_CMD_PIXELS && s_sent.first.pixels.start == 0 &&
+                          s_sent.first.pixels.count == WS2812_MAX_LED_COUNT &&
+                          s_sent.last_pixel.color_rgb.red == (uint8_t)(WS2812_MAX_LED_COUNT - 1) &&
+                          s_sent.last_pixel.color_rgb.green == (uint8_t)((WS2812_MAX_LED_COUNT - 1) >> 8) &&
+                          s_sent.last_pixel.color_rgb.blue == 0x5A,
+                      "whole strip binary body rejected or garbled");
+    ok &= test_expect(test_post_binary("1000", WS2812_MAX_LED_COUNT - 1000) && s_sent.first.pixels.start == 1000 &&
+                          s_sent.first.pixels.count == WS2812_MAX_LED_COUNT - 1000,
+                      "binary body up to the strip end rejected");
+
+    /* One pixels key per operation, a second one would misalign the pixel pool */
+    static const char duplicate[] = "{\"channel\":0,\"pixels\":[\"FF0000\"],\"pixels\":[\"00FF00\",\"0000FF\"]}";
+    ok &= test_expect(!test_post("application/json", NULL, NULL, duplicate, strlen(duplicate)),
+                      "duplicate pixels key accepted");
+    static const char pixels[] = "[{\"channel\":1,\"start\":3,\"pixels\":[\"FF0000\",\"00FF00\"]},"
+                                 "{\"channel\":0,\"pixels\":[\"0000FF\"]}]";
+    ok &= test_expect(test_post("application/json", NULL, NULL, pixels, strlen(pixels)) && s_sent.count == 2 &&
+                          s_sent.first.pixels.start == 3 && s_sent.first.pixels.count == 2 &&
+                          s_sent.first_pixel.color_rgb.red == 0xFF && s_sent.last_pixel.color_rgb.blue == 0xFF,
+                      "pixels of two operations rejected or garbled");
+
+    ESP_LOGI(TAG, "%s", ok ? "passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
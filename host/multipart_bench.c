@@ -0,0 +1,328 @@
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+
+#include "multipart.h"
+
+/* Tag used for console messages */
+static const char *TAG = "multipart_bench";
+
+/* Boundary in the form Chrome uses */
+#define BENCH_BOUNDARY "----WebKitFormBoundary7MA4YWxkTrZu0gW"
+
+/* Longest payload of the split test, long enough for several OTA receive buffers */
+#define BENCH_SPLIT_MAX_PAYLOAD 8192
+
+/**
+ * @brief Output of the parser, body bytes are appended for the comparison
+ */
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t size;
+    size_t calls;
+    size_t moved; /* Bytes which were not in place */
+} bench_output_t;
+
+static esp_err_t bench_collect(void *ctx, const char *data, size_t len)
+{
+    bench_output_t *out = ctx;
+    if (len == 0 || out->len + len > out->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (data != out->data + out->len)
+    {
+        memmove(out->data + out->len, data, len);
+        out->moved += len;
+    }
+    out->len += len;
+    ++out->calls;
+    return ESP_OK;
+}
+
+/**
+ * @brief Consumes body bytes like esp_ota_write() of a zero-copy handler would, only counting them
+ */
+static esp_err_t bench_count(void *ctx, const char *data, size_t len)
+{
+    bench_output_t *out = ctx;
+    out->len += len;
+    ++out->calls;
+    return ESP_OK;
+}
+
+/**
+ * @brief Monotonic wall time in nanoseconds
+ */
+static int64_t bench_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Fills a payload with random bytes, traps adds delimiter prefixes the parser has to pass through
+ */
+static void bench_fill_payload(char *payload, size_t len, bool traps)
+{
+    static const char delimiter[] = "\r\n--" BENCH_BOUNDARY;
+    for (size_t i = 0; i < len; ++i)
+    {
+        payload[i] = (char)rand();
+    }
+    for (size_t i = 0; traps && i + sizeof(delimiter) < len; i += 1 + rand() % 64)
+    {
+        /* Every prefix up to the whole delimiter without its last byte */
+        size_t prefix = 1 + rand() % (sizeof(delimiter) - 2);
+        memcpy(payload + i, delimiter, prefix);
+        i += prefix;
+        /* A random byte could complete the delimiter, which a real file never contains */
+        if (payload[i] == delimiter[prefix])
+        {
+            payload[i] = ~payload[i];
+        }
+    }
+}
+
+/**
+ * @brief Wraps a payload in a multipart/form-data body as a browser uploads a file
+ *
+ * @return body length
+ */
+static size_t bench_build_body(char *body, const char *payload, size_t len, bool preamble)
+{
+    size_t n = 0;
+    if (preamble)
+    {
+        n += sprintf(body + n, "This is the preamble.\r\n");
+    }
+    n += sprintf(body + n,
+                 "--" BENCH_BOUNDARY " \r\n"
+                 "Content-Disposition: form-data; name=\"file\"; filename=\"lamp.bin\"\r\n"
+                 "Content-Type: application/octet-stream\r\n\r\n");
+    memcpy(body + n, payload, len);
+    n += len;
+    n += sprintf(body + n, "\r\n--" BENCH_BOUNDARY "--\r\n");
+    return n;
+}
+
+/**
+ * @brief Feeds a body in random chunks of 1 to max_chunk bytes
+ *
+ * @param body_len bytes of the body fed, shorter than the body to test truncation
+ */
+static esp_err_t bench_feed_split(multipart_parser_t *p, const char *body, size_t body_len, size_t max_chunk)
+{
+    size_t pos = 0;
+    while (pos < body_len)
+    {
+        size_t chunk = 1 + rand() % max_chunk;
+        chunk = chunk < body_len - pos ? chunk : body_len - pos;
+        esp_err_t err = multipart_parser_feed(p, body + pos, chunk);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        pos += chunk;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Feeds a body in random chunks received into the output buffer as the OTA handler does, behind the output
+ *        and the bytes held back by the parser
+ */
+static esp_err_t bench_feed_in_place(multipart_parser_t *p, const char *body, size_t body_len, size_t max_chunk,
+                                     bench_output_t *out)
+{
+    size_t pos = 0;
+    while (pos < body_len)
+    {
+        size_t chunk = 1 + rand() % max_chunk;
+        chunk = chunk < body_len - pos ? chunk : body_len - pos;
+        char *buffer = out->data + out->len + multipart_parser_get_held(p);
+        if (buffer + chunk > out->data + out->size)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(buffer, body + pos, chunk);
+        esp_err_t err = multipart_parser_feed(p, buffer, chunk);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        pos += chunk;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Parses random bodies split at random positions and compares the output with the payload
+ *
+ * @return true if every body was parsed correctly
+ */
+static bool bench_split_test(uint32_t iterations)
+{
+    static const char content_type[] = "multipart/form-data; boundary=" BENCH_BOUNDARY;
+    static char payload[BENCH_SPLIT_MAX_PAYLOAD];
+    static char body[BENCH_SPLIT_MAX_PAYLOAD + 512];
+    static char output[BENCH_SPLIT_MAX_PAYLOAD + 512];
+    size_t moved = 0;
+
+    for (uint32_t it = 0; it < iterations; ++it)
+    {
+        size_t len = rand() % (BENCH_SPLIT_MAX_PAYLOAD + 1);
+        bench_fill_payload(payload, len, it % 2 == 0);
+        size_t body_len = bench_build_body(body, payload, len, it % 3 == 0);
+        /* Mostly tiny chunks to split the delimiters, sometimes whole receive buffers */
+        size_t max_chunk = it % 4 == 0 ? 1024 : 1 + rand() % 16;
+        /* Every 8th body is cut before the end of the close delimiter, it must be reported as not done */
+        bool truncated = it % 8 == 7;
+        size_t fed_len = truncated ? rand() % (body_len - 2) : body_len;
+
+        multipart_parser_t parser;
+        bench_output_t out = {.data = output, .size = sizeof(output)};
+        esp_err_t err = multipart_parser_init(&parser, content_type, bench_collect, &out);
+        /* Odd bodies are received in place, only the bytes behind the part headers may move */
+        bool in_place = it % 2 == 1;
+        if (err == ESP_OK)
+        {
+            err = in_place ? bench_feed_in_place(&parser, body, fed_len, max_chunk, &out)
+                           : bench_feed_split(&parser, body, fed_len, max_chunk);
+        }
+        if (in_place)
+        {
+            moved += out.moved;
+        }
+        bool ok = err == ESP_OK && multipart_parser_is_done(&parser) == !truncated &&
+                  (truncated ? out.len <= len : out.len == len) && memcmp(out.data, payload, out.len) == 0;
+        if (!ok)
+        {
+            ESP_LOGE(TAG, "iteration %u failed: %s, payload %zu bytes, fed %zu of %zu, got %zu bytes", it,
+                     esp_err_to_name(err), len, fed_len, body_len, out.len);
+            return false;
+        }
+    }
+    printf("split test: %u bodies parsed correctly, %zu bytes moved by in place receives\n", iterations, moved);
+    return true;
+}
+
+/**
+ * @brief Measures the parser throughput feeding a body in chunks of the given size
+ *
+ * @return ESP_OK or ESP_ERR_NO_MEM
+ */
+static esp_err_t bench_throughput(const char *name, size_t payload_len, size_t chunk, uint32_t rounds, bool traps)
+{
+    static const char content_type[] = "multipart/form-data; boundary=\"" BENCH_BOUNDARY "\"";
+    char *payload = malloc(payload_len);
+    char *body = malloc(payload_len + 512);
+    if (payload == NULL || body == NULL)
+    {
+        free(payload);
+        free(body);
+        return ESP_ERR_NO_MEM;
+    }
+    bench_fill_payload(payload, payload_len, traps);
+    size_t body_len = bench_build_body(body, payload, payload_len, false);
+
+    bench_output_t out = {0};
+    esp_err_t err = ESP_OK;
+    int64_t start_ns = bench_time_ns();
+    for (uint32_t r = 0; r < rounds && err == ESP_OK; ++r)
+    {
+        multipart_parser_t parser;
+        err = multipart_parser_init(&parser, content_type, bench_count, &out);
+        for (size_t pos = 0; pos < body_len && err == ESP_OK; pos += chunk)
+        {
+            err = multipart_parser_feed(&parser, body + pos, chunk < body_len - pos ? chunk : body_len - pos);
+        }
+        if (err == ESP_OK && !multipart_parser_is_done(&parser))
+        {
+            err = ESP_ERR_INVALID_STATE;
+        }
+    }
+    int64_t total_ns = bench_time_ns() - start_ns;
+
+    if (err == ESP_OK)
+    {
+        printf("%-8s %10zu %8zu %8u %10.1f %12.1f\n", name, payload_len, chunk, rounds,
+               (double)body_len * rounds * 1e3 / (double)total_ns, (double)out.len / (double)out.calls);
+    }
+    free(payload);
+    free(body);
+    return err;
+}
+
+static void bench_usage(const char *program)
+{
+    printf("Usage: %s [-i split_iterations] [-s payload_size] [-c chunk_size] [-r rounds] [-e seed]\n"
+           "Checks the multipart parser on bodies split at random positions and measures its throughput.\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long iterations = 20000;
+    unsigned long payload_len = 1024 * 1024;
+    unsigned long chunk = 1024;
+    unsigned long rounds = 20;
+    unsigned long seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:s:c:r:e:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            iterations = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            payload_len = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            chunk = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rounds = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (chunk == 0 || rounds == 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    srand((unsigned)seed);
+    if (!bench_split_test((uint32_t)iterations))
+    {
+        return EXIT_FAILURE;
+    }
+
+    /* Random firmware-like data, and data full of delimiter prefixes as the worst case */
+    printf("%-8s %10s %8s %8s %10s %12s\n", "payload", "bytes", "chunk", "rounds", "MB/s", "bytes/call");
+    esp_err_t err = bench_throughput("random", payload_len, chunk, (uint32_t)rounds, false);
+    if (err == ESP_OK)
+    {
+        err = bench_throughput("traps", payload_len, chunk, (uint32_t)rounds, true);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "throughput failed: %s", esp_err_to_name(err));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,364 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "ota_writer.h"
+
+/* Tag used for console messages */
+static const char *TAG = "ota_bench";
+
+/* Time step of the model */
+#define BENCH_STEP_US 10
+
+/* Receive buffer of the OTA handler before the slot pipeline */
+#define BENCH_SERIAL_RECV_SIZE 1024
+
+/* TCP maximum segment size, the receiver reopens a closed window once this much is free */
+#define BENCH_MSS 1436
+
+/**
+ * @brief Network and flash timings of the model
+ */
+typedef struct
+{
+    uint32_t image_size;      /* Bytes of the uploaded image */
+    uint32_t partition_size;  /* Bytes of the update partition */
+    uint32_t link_rate;       /* Bytes/s the client sends while the window is open */
+    uint32_t window;          /* TCP receive window of lwIP */
+    uint32_t rtt_us;          /* Round trip until a reopened window brings new data */
+    uint32_t sector_erase_us; /* Erase of one 4 KiB sector */
+    uint32_t block_erase_us;  /* Erase of one 64 KiB block */
+    uint32_t write_rate;      /* Bytes/s of flash page programming */
+} bench_config_t;
+
+/**
+ * @brief Upload paths of the model
+ */
+typedef enum
+{
+    BENCH_PATH_SERIAL = 0, /* esp_ota_begin() erases the partition, then 1 KiB receives alternate with writes */
+    BENCH_PATH_SECTOR,     /* Slot pipeline, each slot write erases the sector it starts */
+    BENCH_PATH_BLOCK,      /* Slot pipeline, the writer erases ahead in 64 KiB blocks */
+} bench_path_e;
+
+static const char *const s_path_names[] = {"serial", "pipe_sector", "pipe_block"};
+
+/**
+ * @brief Result of one modelled upload
+ */
+typedef struct
+{
+    int64_t total_us;
+    int64_t net_idle_us; /* Client waited for the window */
+    int64_t stall_us;    /* Receiver had data but no free slot */
+    int64_t flash_us;    /* Flash erasing and writing */
+} bench_result_t;
+
+/**
+ * @brief Socket receive buffer filled by the client
+ */
+typedef struct
+{
+    uint32_t sent;     /* Bytes the client sent */
+    uint32_t buffered; /* Bytes waiting in the receive buffer */
+    double credit;     /* Fraction of a byte carried to the next step */
+    bool closed;       /* Window was full, the client waits for the window update */
+    int64_t resume_us; /* Client sends again at this time */
+} bench_socket_t;
+
+/**
+ * @brief Duration of erasing [start, end), in blocks where the range covers whole aligned blocks
+ */
+static int64_t bench_erase_us(const bench_config_t *cfg, uint32_t start, uint32_t end)
+{
+    int64_t us = 0;
+    while (start < end)
+    {
+        if (start % OTA_WRITER_ERASE_BLOCK_SIZE == 0 && end - start >= OTA_WRITER_ERASE_BLOCK_SIZE)
+        {
+            us += cfg->block_erase_us;
+            start += OTA_WRITER_ERASE_BLOCK_SIZE;
+        }
+        else
+        {
+            us += cfg->sector_erase_us;
+            start += OTA_WRITER_SECTOR_SIZE;
+        }
+    }
+    return us;
+}
+
+/**
+ * @brief Duration of writing [start, start + len), taken from the totals so short writes do not round to nothing
+ */
+static int64_t bench_write_us(const bench_config_t *cfg, uint32_t start, uint32_t len)
+{
+    return (int64_t)(start + len) * 1000000 / cfg->write_rate - (int64_t)start * 1000000 / cfg->write_rate;
+}
+
+/**
+ * @brief Advances the client by one time step
+ *
+ * @return true if the client waited for the window
+ */
+static bool bench_socket_step(const bench_config_t *cfg, bench_socket_t *sock, int64_t now_us)
+{
+    if (sock->sent == cfg->image_size)
+    {
+        return false;
+    }
+    if (sock->closed)
+    {
+        if (cfg->window - sock->buffered < BENCH_MSS)
+        {
+            return true;
+        }
+        sock->closed = false;
+        sock->resume_us = now_us + cfg->rtt_us;
+    }
+    if (now_us < sock->resume_us)
+    {
+        return true;
+    }
+
+    sock->credit += (double)cfg->link_rate * BENCH_STEP_US / 1000000;
+    uint32_t len = (uint32_t)sock->credit;
+    if (len > cfg->window - sock->buffered)
+    {
+        len = cfg->window - sock->buffered;
+        sock->credit = 0;
+        sock->closed = true;
+    }
+    if (len > cfg->image_size - sock->sent)
+    {
+        len = cfg->image_size - sock->sent;
+    }
+    sock->credit -= len;
+    sock->sent += len;
+    sock->buffered += len;
+    return false;
+}
+
+/**
+ * @brief Takes up to len bytes out of the receive buffer
+ */
+static uint32_t bench_socket_recv(bench_socket_t *sock, uint32_t len)
+{
+    if (len > sock->buffered)
+    {
+        len = sock->buffered;
+    }
+    sock->buffered -= len;
+    return len;
+}
+
+/**
+ * @brief Models the handler before the slot pipeline: erase the partition, then receive and write in turn
+ */
+static bench_result_t bench_serial(const bench_config_t *cfg)
+{
+    bench_result_t result = {0};
+    bench_socket_t sock = {0};
+    uint32_t written = 0;
+
+    /* esp_ota_begin(OTA_SIZE_UNKNOWN) erases the whole partition while the client already sends */
+    int64_t busy_until_us = bench_erase_us(cfg, 0, cfg->partition_size);
+    result.flash_us = busy_until_us;
+
+    int64_t now_us = 0;
+    for (; written < cfg->image_size || now_us < busy_until_us; now_us += BENCH_STEP_US)
+    {
+        result.net_idle_us += bench_socket_step(cfg, &sock, now_us) ? BENCH_STEP_US : 0;
+        if (now_us >= busy_until_us && written < cfg->image_size)
+        {
+            uint32_t len = bench_socket_recv(&sock, BENCH_SERIAL_RECV_SIZE);
+            if (len > 0)
+            {
+                busy_until_us = now_us + bench_write_us(cfg, written, len);
+                result.flash_us += busy_until_us - now_us;
+                written += len;
+            }
+        }
+    }
+    result.total_us = now_us;
+    return result;
+}
+
+/**
+ * @brief Models the slot pipeline of ota_writer, the receiver fills slots while the writer task empties them
+ *
+ * @param block_erase erase ahead in blocks instead of one sector per slot
+ * @param cache_stall flash operations stop the receiver, as on an ESP32 where they disable the cache of both cores
+ */
+static bench_result_t bench_pipeline(const bench_config_t *cfg, bool block_erase, bool cache_stall)
+{
+    bench_result_t result = {0};
+    bench_socket_t sock = {0};
+    uint32_t free_slots = OTA_WRITER_SLOT_COUNT;
+    uint32_t queued[OTA_WRITER_SLOT_COUNT]; /* Lengths of the submitted slots in order */
+    uint32_t queue_head = 0, queue_count = 0;
+    bool filling = false;
+    uint32_t fill = 0;
+    uint32_t received = 0, written = 0, erased_end = 0;
+    bool writing = false;
+    int64_t busy_until_us = 0;
+
+    int64_t now_us = 0;
+    for (; written < cfg->image_size; now_us += BENCH_STEP_US)
+    {
+        result.net_idle_us += bench_socket_step(cfg, &sock, now_us) ? BENCH_STEP_US : 0;
+
+        /* Writer task returns a written slot and takes the next one */
+        if (writing && now_us >= busy_until_us)
+        {
+            writing = false;
+            ++free_slots;
+        }
+        if (!writing && queue_count > 0)
+        {
+            uint32_t len = queued[queue_head];
+            queue_head = (queue_head + 1) % OTA_WRITER_SLOT_COUNT;
+            --queue_count;
+
+            int64_t us = bench_write_us(cfg, written, len);
+            if (written + len > erased_end)
+            {
+                uint32_t unit = block_erase ? OTA_WRITER_ERASE_BLOCK_SIZE : OTA_WRITER_SECTOR_SIZE;
+                uint32_t erase_end = (written + len + unit - 1) / unit * unit;
+                if (erase_end > cfg->partition_size)
+                {
+                    erase_end = cfg->partition_size;
+                }
+                us += bench_erase_us(cfg, erased_end, erase_end);
+                erased_end = erase_end;
+            }
+            busy_until_us = now_us + us;
+            result.flash_us += us;
+            written += len;
+            writing = true;
+        }
+
+        /* Receiver fills a slot and submits it once full or at the end of the image */
+        if (received == cfg->image_size || (cache_stall && writing))
+        {
+            continue;
+        }
+        if (!filling)
+        {
+            if (free_slots == 0)
+            {
+                result.stall_us += sock.buffered > 0 ? BENCH_STEP_US : 0;
+                continue;
+            }
+            --free_slots;
+            filling = true;
+            fill = 0;
+        }
+        uint32_t len = bench_socket_recv(&sock, OTA_WRITER_SLOT_SIZE - fill);
+        fill += len;
+        received += len;
+        if (fill == OTA_WRITER_SLOT_SIZE || received == cfg->image_size)
+        {
+            queued[(queue_head + queue_count) % OTA_WRITER_SLOT_COUNT] = fill;
+            ++queue_count;
+            filling = false;
+        }
+    }
+    result.total_us = now_us > busy_until_us ? now_us : busy_until_us;
+    return result;
+}
+
+static void bench_print(const bench_config_t *cfg, bench_path_e path, const char *flash, const bench_result_t *r)
+{
+    printf("%-12s %-8s %9.0f %8.1f %12.0f %10.0f %10.0f\n", s_path_names[path], flash, r->total_us / 1000.0,
+           (double)cfg->image_size / 1024 / (r->total_us / 1000000.0), r->net_idle_us / 1000.0,
+           r->stall_us / 1000.0, r->flash_us / 1000.0);
+}
+
+static void bench_usage(const char *program)
+{
+    printf("Usage: %s [-s image_size] [-p partition_size] [-n link_KBps] [-w window] [-r rtt_us]\n"
+           "          [-e sector_erase_us] [-b block_erase_us] [-f flash_write_KBps]\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    /* Defaults: 1 MiB image, ota_0 of partitions.csv, typical SPI NOR timings and the lwIP default window */
+    bench_config_t cfg = {
+        .image_size = 1024 * 1024,
+        .partition_size = 1300 * 1024,
+        .link_rate = 1000 * 1024,
+        .window = 5744,
+        .rtt_us = 5000,
+        .sector_erase_us = 45000,
+        .block_erase_us = 150000,
+        .write_rate = 400 * 1024,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:n:w:r:e:b:f:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            cfg.image_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            cfg.partition_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            cfg.link_rate = strtoul(optarg, NULL, 10) * 1024;
+            break;
+        case 'w':
+            cfg.window = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            cfg.rtt_us = strtoul(optarg, NULL, 10);
+            break;
+        case 'e':
+            cfg.sector_erase_us = strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            cfg.block_erase_us = strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            cfg.write_rate = strtoul(optarg, NULL, 10) * 1024;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (cfg.image_size == 0 || cfg.partition_size % OTA_WRITER_SECTOR_SIZE != 0 ||
+        cfg.image_size > cfg.partition_size || cfg.link_rate == 0 || cfg.window <= BENCH_MSS ||
+        cfg.write_rate == 0)
+    {
+        ESP_LOGE(TAG, "invalid configuration");
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("image %u bytes, partition %u bytes, link %u KB/s, window %u bytes, rtt %u us\n", cfg.image_size,
+           cfg.partition_size, cfg.link_rate / 1024, cfg.window, cfg.rtt_us);
+    printf("sector erase %u us, block erase %u us, flash write %u KB/s, %u slots of %u bytes\n",
+           cfg.sector_erase_us, cfg.block_erase_us, cfg.write_rate / 1024, OTA_WRITER_SLOT_COUNT,
+           OTA_WRITER_SLOT_SIZE);
+    printf("%-12s %-8s %9s %8s %12s %10s %10s\n", "path", "flash", "total_ms", "KB/s", "net_idle_ms", "stall_ms",
+           "flash_ms");
+
+    bench_result_t result = bench_serial(&cfg);
+    bench_print(&cfg, BENCH_PATH_SERIAL, "-", &result);
+    for (bench_path_e path = BENCH_PATH_SECTOR; path <= BENCH_PATH_BLOCK; ++path)
+    {
+        result = bench_pipeline(&cfg, path == BENCH_PATH_BLOCK, false);
+        bench_print(&cfg, path, "overlap", &result);
+        result = bench_pipeline(&cfg, path == BENCH_PATH_BLOCK, true);
+        bench_print(&cfg, path, "stall", &result);
+    }
+    return EXIT_SUCCESS;
+}
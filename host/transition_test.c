@@ -0,0 +1,122 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "ws2812_render.h"
+
+/* Tag used for console messages */
+static const char *TAG = "transition_test";
+
+/* Fade duration of the test and the time step between frames */
+#define TEST_TRANSITION_MS 300
+#define TEST_STEP_US 250
+
+/* Start of the fade, not 0 so times relative to the transition start are tested */
+#define TEST_START_US 1000000
+
+/**
+ * @brief Start and target value of the faded color channel
+ */
+typedef struct
+{
+    uint8_t from, to;
+} test_fade_t;
+
+/* Both directions, full and partial ranges and steps shorter than the frame count */
+static const test_fade_t s_fades[] = {
+    {0, 255}, {255, 0}, {17, 200}, {200, 17}, {1, 2}, {2, 1}, {128, 128}, {0, 1}, {254, 255},
+};
+
+/**
+ * @brief Color with the faded channel set to value, the others to fixed values which must not change
+ */
+static rgb_color_t test_color(uint32_t channel, uint8_t value)
+{
+    rgb_color_t color = RGB_COLOR(40, 80, 120);
+    color.color[channel] = value;
+    return color;
+}
+
+/**
+ * @brief Fades one color channel of a one pixel strip and checks every frame of the fade
+ *
+ * @return true if the fade is monotonic, does not touch the other channels and ends exactly on the target
+ */
+static bool test_fade(ws2812_render_channel_t *ch, uint32_t channel, const test_fade_t *fade)
+{
+    rgb_color_t from = test_color(channel, fade->from);
+    rgb_color_t to = test_color(channel, fade->to);
+
+    /* Show the start color instantly */
+    ws2812_render_set_transition_ms(0);
+    ws2812_command_t cmd = {.type = WS2812_CMD_COLOR, .channel = 0, .color = from};
+    ws2812_render_apply_command(ch, &cmd, 0);
+    ws2812_render_frame(ch, 0);
+
+    ws2812_render_set_transition_ms(TEST_TRANSITION_MS);
+    cmd.color = to;
+    ws2812_render_apply_command(ch, &cmd, TEST_START_US);
+
+    uint8_t previous = fade->from;
+    for (int64_t t_us = 0; t_us <= TEST_TRANSITION_MS * 1000; t_us += TEST_STEP_US)
+    {
+        ws2812_render_frame(ch, TEST_START_US + t_us);
+        rgb_color_t shown = ch->display[0];
+        uint8_t value = shown.color[channel];
+
+        bool monotonic = fade->to >= fade->from ? value >= previous : value <= previous;
+        bool in_range = fade->to >= fade->from ? value >= fade->from && value <= fade->to
+                                               : value <= fade->from && value >= fade->to;
+        if (!monotonic || !in_range)
+        {
+            ESP_LOGE(TAG, "channel %u %u -> %u: %u after %u at %lld us", channel, fade->from, fade->to, value,
+                     previous, (long long)t_us);
+            return false;
+        }
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            if (c != channel && shown.color[c] != to.color[c])
+            {
+                ESP_LOGE(TAG, "channel %u %u -> %u: channel %u changed to %u at %lld us", channel, fade->from,
+                         fade->to, c, shown.color[c], (long long)t_us);
+                return false;
+            }
+        }
+        previous = value;
+    }
+
+    if (previous != fade->to || ch->transition_active)
+    {
+        ESP_LOGE(TAG, "channel %u %u -> %u: %u at %d ms, transition %s", channel, fade->from, fade->to, previous,
+                 TEST_TRANSITION_MS, ch->transition_active ? "still active" : "done");
+        return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    ws2812_strip_config_t config = {.led_count = 1, .resolution_hz = WS2812_DEFAULT_RESOLUTION_HZ};
+    ws2812_render_channel_t ch;
+
+    ws2812_render_init();
+    if (!ws2812_render_init_channel(&ch, &config))
+    {
+        ESP_LOGE(TAG, "channel init failed");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    for (uint32_t channel = 0; channel < 3; ++channel)
+    {
+        for (size_t i = 0; i < sizeof(s_fades) / sizeof(s_fades[0]); ++i)
+        {
+            ok &= test_fade(&ch, channel, &s_fades[i]);
+        }
+    }
+    ws2812_render_free_channel(&ch);
+
+    ESP_LOGI(TAG, "%s", ok ? "passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,167 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+
+#include "ws2812_sim.h"
+
+/* Tag used for console messages */
+static const char *TAG = "ws2812_sim";
+
+/**
+ * @brief Simulated strip of one channel, keeps the last frames in a ring
+ */
+typedef struct
+{
+    uint8_t channel;
+    uint32_t led_count;
+    uint32_t frame_count;
+    uint32_t history_length;
+    ws2812_sim_frame_header_t *headers;
+    rgb_color_t *pixels;
+} ws2812_sim_channel_t;
+
+static ws2812_sim_channel_t s_sim_channels[WS2812_MAX_CHANNELS];
+static ws2812_sim_config_t s_sim_config;
+/* Channels may be written from their own threads, frames are appended to the record file one at a time */
+static pthread_mutex_t s_record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Monotonic time, the host counterpart of esp_timer_get_time()
+ */
+static int64_t ws2812_sim_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Spends the wire time of a frame as configured
+ */
+static void ws2812_sim_wire_wait(uint32_t wire_us)
+{
+    if (s_sim_config.wire == WS2812_SIM_WIRE_BUSY)
+    {
+        int64_t end_us = ws2812_sim_time_us() + wire_us;
+        while (ws2812_sim_time_us() < end_us)
+        {
+        }
+    }
+    else if (s_sim_config.wire == WS2812_SIM_WIRE_SLEEP)
+    {
+        struct timespec ts = {.tv_sec = wire_us / 1000000, .tv_nsec = (long)(wire_us % 1000000) * 1000};
+        nanosleep(&ts, NULL);
+    }
+}
+
+void ws2812_sim_configure(const ws2812_sim_config_t *config)
+{
+    s_sim_config = *config;
+}
+
+uint32_t ws2812_sim_get_frame_count(uint8_t channel)
+{
+    return channel < WS2812_MAX_CHANNELS ? s_sim_channels[channel].frame_count : 0;
+}
+
+esp_err_t ws2812_sim_get_frame(uint8_t channel, uint32_t age, ws2812_sim_frame_t *frame)
+{
+    if (channel >= WS2812_MAX_CHANNELS)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const ws2812_sim_channel_t *sim = &s_sim_channels[channel];
+    if (age >= sim->history_length || age >= sim->frame_count)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t slot = (sim->frame_count - 1 - age) % sim->history_length;
+    frame->header = sim->headers[slot];
+    frame->pixels = sim->pixels + slot * sim->led_count;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_sim_init(uint8_t channel, ws2812_strip_config_t *config, void **ctx)
+{
+    if (channel >= WS2812_MAX_CHANNELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ws2812_sim_channel_t *sim = &s_sim_channels[channel];
+    memset(sim, 0, sizeof(*sim));
+    sim->channel = channel;
+    sim->led_count = config->led_count;
+    sim->history_length = s_sim_config.history_length;
+    if (sim->history_length > 0)
+    {
+        sim->headers = calloc(sim->history_length, sizeof(ws2812_sim_frame_header_t));
+        sim->pixels = calloc((size_t)sim->history_length * sim->led_count, sizeof(rgb_color_t));
+        if (sim->headers == NULL || sim->pixels == NULL)
+        {
+            free(sim->headers);
+            free(sim->pixels);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGD(TAG, "channel %u: %u pixels, keeping %u frames", channel, config->led_count, sim->history_length);
+    *ctx = sim;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_sim_write(void *ctx, const rgb_color_t *frame, uint32_t led_count)
+{
+    ws2812_sim_channel_t *sim = (ws2812_sim_channel_t *)ctx;
+    if (led_count > sim->led_count)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ws2812_sim_frame_header_t header = {
+        .timestamp_us = ws2812_sim_time_us(),
+        .wire_us = (uint32_t)((uint64_t)led_count * WS2812_SIM_PIXEL_WIRE_NS / 1000) + WS2812_SIM_RESET_US,
+        .led_count = (uint16_t)led_count,
+        .channel = sim->channel,
+    };
+
+    if (sim->history_length > 0)
+    {
+        uint32_t slot = sim->frame_count % sim->history_length;
+        sim->headers[slot] = header;
+        memcpy(sim->pixels + slot * sim->led_count, frame, led_count * sizeof(rgb_color_t));
+    }
+    if (s_sim_config.record_file != NULL)
+    {
+        pthread_mutex_lock(&s_record_lock);
+        bool written = fwrite(&header, sizeof(header), 1, s_sim_config.record_file) == 1 &&
+                       fwrite(frame, sizeof(rgb_color_t), led_count, s_sim_config.record_file) == led_count;
+        pthread_mutex_unlock(&s_record_lock);
+        if (!written)
+        {
+            return ESP_FAIL;
+        }
+    }
+    ++sim->frame_count;
+    ws2812_sim_wire_wait(header.wire_us);
+    return ESP_OK;
+}
+
+static void ws2812_sim_deinit(void *ctx)
+{
+    ws2812_sim_channel_t *sim = (ws2812_sim_channel_t *)ctx;
+    free(sim->headers);
+    free(sim->pixels);
+    memset(sim, 0, sizeof(*sim));
+}
+
+const ws2812_backend_t ws2812_sim_backend = {
+    .name = "sim",
+    .init = ws2812_sim_init,
+    .write = ws2812_sim_write,
+    .deinit = ws2812_sim_deinit,
+};
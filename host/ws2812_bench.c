@@ -0,0 +1,549 @@
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+
+#include "ws2812_sim.h"
+
+/* Tag used for console messages */
+static const char *TAG = "ws2812_bench";
+
+/* Frames between color changes in the transition scenario, shorter than the default cross-fade */
+#define BENCH_TRANSITION_EVERY_FRAMES 12
+
+/* Output stage sweep: pixels composed per LED count and per path, and the brightness of the comparison */
+#define BENCH_GAMMA_PIXELS 20000000
+#define BENCH_GAMMA_BRIGHTNESS 160
+#define BENCH_GAMMA 2.2f
+
+/**
+ * @brief Benchmark scenario: one effect of the registry, or color changes cross-faded by the transition
+ */
+typedef struct
+{
+    const char *name;
+    ws2812_effect_e effect; /* WS2812_EFFECT_NONE for the transition scenario */
+} bench_scenario_t;
+
+/**
+ * @brief Command of the scenario applied before the frame
+ *
+ * @return true if cmd has to be applied
+ */
+static bool bench_step(const bench_scenario_t *scenario, uint32_t frame, ws2812_command_t *cmd)
+{
+    if (scenario->effect != WS2812_EFFECT_NONE)
+    {
+        if (frame != 0)
+        {
+            return false;
+        }
+        cmd->type = WS2812_CMD_EFFECT;
+        cmd->effect.effect = scenario->effect;
+        cmd->effect.params = ws2812_effect_get(scenario->effect)->default_params;
+        return true;
+    }
+
+    if (frame % BENCH_TRANSITION_EVERY_FRAMES != 0)
+    {
+        return false;
+    }
+    cmd->type = WS2812_CMD_COLOR;
+    cmd->color = color_to_rgb_struct((color_e)((frame / BENCH_TRANSITION_EVERY_FRAMES) % color_COUNT));
+    return true;
+}
+
+/**
+ * @brief Monotonic wall time in nanoseconds
+ */
+static int64_t bench_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bench_compare_ns(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Transmit thread of one channel, the host counterpart of the tx task of the firmware
+ */
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    void *backend_ctx;
+    const rgb_color_t *frame; /* Frame being sent, NULL when idle */
+    uint32_t led_count;
+    bool stop;
+    esp_err_t err; /* First error of the backend */
+} bench_tx_t;
+
+static void *bench_tx_thread(void *arg)
+{
+    bench_tx_t *tx = arg;
+
+    pthread_mutex_lock(&tx->lock);
+    for (;;)
+    {
+        while (tx->frame == NULL && !tx->stop)
+        {
+            pthread_cond_wait(&tx->cond, &tx->lock);
+        }
+        if (tx->frame == NULL)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&tx->lock);
+        esp_err_t err = ws2812_sim_backend.write(tx->backend_ctx, tx->frame, tx->led_count);
+        pthread_mutex_lock(&tx->lock);
+        if (tx->err == ESP_OK)
+        {
+            tx->err = err;
+        }
+        tx->frame = NULL;
+        pthread_cond_broadcast(&tx->cond);
+    }
+    pthread_mutex_unlock(&tx->lock);
+    return NULL;
+}
+
+/**
+ * @brief Waits until the previous frame of the channel has left the wire
+ *
+ * @return error of the backend
+ */
+static esp_err_t bench_tx_wait(bench_tx_t *tx)
+{
+    pthread_mutex_lock(&tx->lock);
+    while (tx->frame != NULL)
+    {
+        pthread_cond_wait(&tx->cond, &tx->lock);
+    }
+    esp_err_t err = tx->err;
+    pthread_mutex_unlock(&tx->lock);
+    return err;
+}
+
+/**
+ * @brief Hands a frame to the idle transmit thread
+ */
+static void bench_tx_start(bench_tx_t *tx, const rgb_color_t *frame, uint32_t led_count)
+{
+    pthread_mutex_lock(&tx->lock);
+    tx->frame = frame;
+    tx->led_count = led_count;
+    pthread_cond_broadcast(&tx->cond);
+    pthread_mutex_unlock(&tx->lock);
+}
+
+/**
+ * @brief Stops the transmit thread once its frame is sent
+ */
+static void bench_tx_stop(bench_tx_t *tx)
+{
+    pthread_mutex_lock(&tx->lock);
+    tx->stop = true;
+    pthread_cond_broadcast(&tx->cond);
+    pthread_mutex_unlock(&tx->lock);
+    pthread_join(tx->thread, NULL);
+    pthread_cond_destroy(&tx->cond);
+    pthread_mutex_destroy(&tx->lock);
+}
+
+/**
+ * @brief CPU time of the calling thread or of the whole process in nanoseconds
+ */
+static int64_t bench_cpu_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Runs one scenario at full speed, the animation clock still advances by one frame period per frame
+ *
+ * @note Inline, the render loop calls the backend itself and waits for every channel in turn. With tx threads
+ *       each channel is sent by its own thread from one of two output frames, the way the firmware does it in
+ *       DMA mode: the render loop only waits when the previous frame of a channel is still on the wire.
+ *
+ * @param tx_threads send through one transmit thread per channel instead of inline
+ * @return ESP_OK, otherwise error of the backend or ESP_ERR_NO_MEM
+ */
+static esp_err_t bench_run(const bench_scenario_t *scenario, const ws2812_strip_config_t *config,
+                           uint8_t channel_count, uint32_t frame_count, bool tx_threads)
+{
+    ws2812_render_channel_t channels[WS2812_MAX_CHANNELS];
+    void *backend_ctx[WS2812_MAX_CHANNELS];
+    bench_tx_t tx[WS2812_MAX_CHANNELS];
+    uint32_t output_back[WS2812_MAX_CHANNELS] = {0};
+    /* Two output frames per channel, the render loop composes one while the other is sent */
+    rgb_color_t *output = calloc((size_t)2 * channel_count * config->led_count, sizeof(rgb_color_t));
+    int64_t *latency_ns = calloc(frame_count, sizeof(int64_t));
+    if (output == NULL || latency_ns == NULL)
+    {
+        free(output);
+        free(latency_ns);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* On a failure the frame loop is skipped and only the initialized channels are released */
+    esp_err_t err = ESP_OK;
+    uint8_t initialized = 0;
+    for (uint8_t c = 0; c < channel_count; ++c)
+    {
+        ws2812_strip_config_t channel_config = *config;
+        err = ws2812_sim_backend.init(c, &channel_config, &backend_ctx[c]);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        if (!ws2812_render_init_channel(&channels[c], &channel_config))
+        {
+            ws2812_sim_backend.deinit(backend_ctx[c]);
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        if (tx_threads)
+        {
+            memset(&tx[c], 0, sizeof(tx[c]));
+            tx[c].backend_ctx = backend_ctx[c];
+            pthread_mutex_init(&tx[c].lock, NULL);
+            pthread_cond_init(&tx[c].cond, NULL);
+            if (pthread_create(&tx[c].thread, NULL, bench_tx_thread, &tx[c]) != 0)
+            {
+                pthread_cond_destroy(&tx[c].cond);
+                pthread_mutex_destroy(&tx[c].lock);
+                ws2812_render_free_channel(&channels[c]);
+                ws2812_sim_backend.deinit(backend_ctx[c]);
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+        initialized = c + 1;
+    }
+
+    int64_t now_us = 0;
+    ws2812_command_t cmd = {.channel = WS2812_CHANNEL_ALL};
+    uint32_t pushed = 0;
+    int64_t render_ns = 0;
+    int64_t start_ns = bench_time_ns();
+    int64_t start_cpu_ns = bench_cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+    int64_t start_process_cpu_ns = bench_cpu_ns(CLOCK_PROCESS_CPUTIME_ID);
+    for (uint32_t f = 0; f < frame_count && err == ESP_OK; ++f)
+    {
+        now_us += WS2812_FRAME_PERIOD_US;
+        int64_t frame_start_ns = bench_time_ns();
+        bool apply = bench_step(scenario, f, &cmd);
+        for (uint8_t c = 0; c < channel_count && err == ESP_OK; ++c)
+        {
+            if (apply)
+            {
+                ws2812_render_apply_command(&channels[c], &cmd, now_us);
+            }
+            int64_t render_start_ns = bench_time_ns();
+            ws2812_render_frame(&channels[c], now_us);
+            render_ns += bench_time_ns() - render_start_ns;
+            if (!channels[c].display_dirty)
+            {
+                continue;
+            }
+            channels[c].display_dirty = false;
+            rgb_color_t *back = output + ((size_t)2 * c + output_back[c]) * config->led_count;
+            ws2812_render_compose_output(&channels[c], back);
+            if (tx_threads)
+            {
+                err = bench_tx_wait(&tx[c]);
+                bench_tx_start(&tx[c], back, channels[c].led_count);
+                output_back[c] ^= 1;
+            }
+            else
+            {
+                err = ws2812_sim_backend.write(backend_ctx[c], back, channels[c].led_count);
+            }
+            ++pushed;
+        }
+        latency_ns[f] = bench_time_ns() - frame_start_ns;
+    }
+    for (uint8_t c = 0; tx_threads && c < initialized; ++c)
+    {
+        esp_err_t tx_err = bench_tx_wait(&tx[c]);
+        err = err == ESP_OK ? tx_err : err;
+    }
+    int64_t total_ns = bench_time_ns() - start_ns;
+    int64_t cpu_ns = bench_cpu_ns(CLOCK_THREAD_CPUTIME_ID) - start_cpu_ns;
+    int64_t process_cpu_ns = bench_cpu_ns(CLOCK_PROCESS_CPUTIME_ID) - start_process_cpu_ns;
+
+    if (err == ESP_OK)
+    {
+        qsort(latency_ns, frame_count, sizeof(int64_t), bench_compare_ns);
+        uint64_t pixels = (uint64_t)frame_count * config->led_count * channel_count;
+        printf("%-12s %-6s %8u %8u %10.0f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+               scenario->name, tx_threads ? "thread" : "inline", frame_count, pushed,
+               frame_count * 1e9 / (double)total_ns, total_ns / 1e3 / frame_count, latency_ns[frame_count / 2] / 1e3,
+               latency_ns[frame_count * 99 / 100] / 1e3, latency_ns[frame_count - 1] / 1e3,
+               (double)render_ns / (double)pixels, (double)total_ns / (double)pixels, cpu_ns / 1e3 / frame_count,
+               process_cpu_ns / 1e3 / frame_count);
+    }
+
+    for (uint8_t c = 0; c < initialized; ++c)
+    {
+        if (tx_threads)
+        {
+            bench_tx_stop(&tx[c]);
+        }
+        ws2812_render_free_channel(&channels[c]);
+        ws2812_sim_backend.deinit(backend_ctx[c]);
+    }
+    free(output);
+    free(latency_ns);
+    return err;
+}
+
+/**
+ * @brief Output stage without the LUT: brightness and gamma computed in float for every pixel channel, the
+ *        way it is done without ws2812_build_output_lut(). GRB strips only, so channels are not permuted.
+ */
+static void bench_compose_float(const ws2812_render_channel_t *ch, rgb_color_t *out, uint8_t brightness)
+{
+    for (uint32_t i = 0; i < ch->led_count; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            float level = (float)ch->display[i].color[c] * brightness / (UINT8_MAX * UINT8_MAX);
+            out[i].color[c] = (uint8_t)(powf(level, BENCH_GAMMA) * UINT8_MAX + 0.5f);
+        }
+    }
+}
+
+/**
+ * @brief Times the output stage with the LUT and with float gamma over LED counts from 15 to 1000
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM
+ */
+static esp_err_t bench_gamma_sweep()
+{
+    static const uint16_t led_counts[] = {15, 30, 60, 150, 300, 600, 1000};
+
+    printf("output stage, brightness %d, gamma %.1f\n", BENCH_GAMMA_BRIGHTNESS, BENCH_GAMMA);
+    printf("%8s %10s %12s %12s %10s %10s\n", "leds", "frames", "lut_ns/px", "float_ns/px", "speedup", "max_diff");
+    ws2812_render_set_brightness(BENCH_GAMMA_BRIGHTNESS);
+
+    for (size_t n = 0; n < sizeof(led_counts) / sizeof(led_counts[0]); ++n)
+    {
+        ws2812_strip_config_t config = {
+            .led_count = led_counts[n],
+            .color_order = WS2812_ORDER_GRB,
+            .resolution_hz = WS2812_DEFAULT_RESOLUTION_HZ,
+        };
+        ws2812_render_channel_t ch;
+        rgb_color_t *lut_out = calloc(config.led_count, sizeof(rgb_color_t));
+        rgb_color_t *float_out = calloc(config.led_count, sizeof(rgb_color_t));
+        if (lut_out == NULL || float_out == NULL || !ws2812_render_init_channel(&ch, &config))
+        {
+            free(lut_out);
+            free(float_out);
+            return ESP_ERR_NO_MEM;
+        }
+
+        /* Every channel value appears in the frame */
+        for (uint32_t i = 0; i < ch.led_count; ++i)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                ch.display[i].color[c] = (uint8_t)(i * 3 + c * 85);
+            }
+        }
+
+        uint32_t frames = BENCH_GAMMA_PIXELS / config.led_count;
+        uint32_t checksum = 0;
+        int64_t start_ns = bench_time_ns();
+        for (uint32_t f = 0; f < frames; ++f)
+        {
+            ws2812_render_compose_output(&ch, lut_out);
+            checksum += lut_out[f % config.led_count].color[f % 3];
+        }
+        int64_t lut_ns = bench_time_ns() - start_ns;
+
+        start_ns = bench_time_ns();
+        for (uint32_t f = 0; f < frames; ++f)
+        {
+            bench_compose_float(&ch, float_out, BENCH_GAMMA_BRIGHTNESS);
+            checksum += float_out[f % config.led_count].color[f % 3];
+        }
+        int64_t float_ns = bench_time_ns() - start_ns;
+
+        /* The table is rounded from the same curve, so both paths agree within one step */
+        int max_diff = 0;
+        for (uint32_t i = 0; i < ch.led_count; ++i)
+        {
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                int diff = abs((int)lut_out[i].color[c] - (int)float_out[i].color[c]);
+                max_diff = diff > max_diff ? diff : max_diff;
+            }
+        }
+
+        double pixels = (double)frames * config.led_count;
+        printf("%8u %10u %12.2f %12.2f %10.1f %10d\n", config.led_count, frames, lut_ns / pixels, float_ns / pixels,
+               (double)float_ns / (double)lut_ns, max_diff);
+        ESP_LOGD(TAG, "checksum %u", checksum);
+
+        ws2812_render_free_channel(&ch);
+        free(lut_out);
+        free(float_out);
+    }
+    ws2812_render_set_brightness(UINT8_MAX);
+    return ESP_OK;
+}
+
+static void bench_usage(const char *program)
+{
+    printf("Usage: %s [-l led_count] [-c channel_count] [-f frame_count] [-s scenario] [-o record_file]\n"
+           "          [-w none|busy|sleep] [-g]\n"
+           "Runs the ws2812 render engine on the simulator backend at full speed, pushing frames inline and\n"
+           "through one transmit thread per channel.\n"
+           "-w spends the wire time of every frame in the write: busy spins like a CPU feeding the strip, sleep\n"
+           "waits like a peripheral sending on its own. none, the default, measures the engine only.\n"
+           "-g compares the output LUT with float gamma per pixel for 15 to 1000 LEDs instead.\n"
+           "Scenarios: effect names from the registry and transition, all scenarios are run by default.\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    ws2812_strip_config_t config = {
+        .led_count = 300,
+        .gpio = WS2812_DEFAULT_GPIO,
+        .color_order = WS2812_ORDER_GRB,
+        .resolution_hz = WS2812_DEFAULT_RESOLUTION_HZ,
+    };
+    unsigned long channel_count = 1;
+    unsigned long frame_count = 10000;
+    const char *scenario_name = NULL;
+    bool gamma_sweep = false;
+    ws2812_sim_config_t sim_config = {.history_length = 0, .record_file = NULL, .wire = WS2812_SIM_WIRE_NONE};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:c:f:s:o:w:gh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            config.led_count = (uint16_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            channel_count = strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            frame_count = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            scenario_name = optarg;
+            break;
+        case 'g':
+            gamma_sweep = true;
+            break;
+        case 'w':
+            if (strcmp(optarg, "busy") == 0)
+            {
+                sim_config.wire = WS2812_SIM_WIRE_BUSY;
+            }
+            else if (strcmp(optarg, "sleep") == 0)
+            {
+                sim_config.wire = WS2812_SIM_WIRE_SLEEP;
+            }
+            else if (strcmp(optarg, "none") != 0)
+            {
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            sim_config.record_file = fopen(optarg, "wb");
+            if (sim_config.record_file == NULL)
+            {
+                ESP_LOGE(TAG, "unable to open %s", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            bench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (config.led_count == 0 || config.led_count > WS2812_MAX_LED_COUNT || channel_count == 0 ||
+        channel_count > WS2812_MAX_CHANNELS || frame_count == 0)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ws2812_sim_configure(&sim_config);
+    ws2812_render_init();
+    if (gamma_sweep)
+    {
+        return bench_gamma_sweep() == ESP_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    uint32_t wire_us = (uint32_t)((uint64_t)config.led_count * WS2812_SIM_PIXEL_WIRE_NS / 1000) + WS2812_SIM_RESET_US;
+    static const char *const wire_names[] = {"not simulated", "busy", "sleep"};
+    printf("%u pixels x %lu channels, %lu frames, %u us on the wire per channel frame, %s\n", config.led_count,
+           channel_count, frame_count, wire_us, wire_names[sim_config.wire]);
+    printf("%-12s %-6s %8s %8s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "scenario", "push", "frames",
+           "pushed", "fps", "avg_us", "p50_us", "p99_us", "max_us", "render_ns/px", "total_ns/px", "cpu_us/f",
+           "all_cpu_us/f");
+
+    /* Every effect of the registry, followed by the transition scenario */
+    bool found = false;
+    for (uint32_t e = 1; e <= WS2812_EFFECT_COUNT; ++e)
+    {
+        bench_scenario_t scenario = {.name = "transition", .effect = WS2812_EFFECT_NONE};
+        if (e < WS2812_EFFECT_COUNT)
+        {
+            const ws2812_effect_info_t *info = ws2812_effect_get((ws2812_effect_e)e);
+            if (info == NULL)
+            {
+                continue;
+            }
+            scenario.name = info->name;
+            scenario.effect = (ws2812_effect_e)e;
+        }
+        if (scenario_name != NULL && strcmp(scenario_name, scenario.name) != 0)
+        {
+            continue;
+        }
+        found = true;
+        for (uint32_t tx_threads = 0; tx_threads < 2; ++tx_threads)
+        {
+            esp_err_t err =
+                bench_run(&scenario, &config, (uint8_t)channel_count, (uint32_t)frame_count, tx_threads != 0);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "%s failed: %s", scenario.name, esp_err_to_name(err));
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (sim_config.record_file != NULL)
+    {
+        fclose(sim_config.record_file);
+    }
+    if (!found)
+    {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#ifndef WS2812_SIM_H_
+#define WS2812_SIM_H_
+
+#include <stdio.h>
+
+#include "ws2812_backend.h"
+
+/* WS2812 wire timing: 24 bits of 1.25 us per pixel followed by the reset (latch) pulse */
+#define WS2812_SIM_PIXEL_WIRE_NS 30000
+#define WS2812_SIM_RESET_US 280
+
+/**
+ * @brief How a simulated write spends the wire time of the frame
+ */
+typedef enum
+{
+    WS2812_SIM_WIRE_NONE = 0, /* Returns right away, only the engine is measured */
+    WS2812_SIM_WIRE_BUSY,     /* Spins for the wire time, a CPU feeding the strip */
+    WS2812_SIM_WIRE_SLEEP,    /* Sleeps for the wire time, a peripheral sending while the CPU is free */
+} ws2812_sim_wire_e;
+
+/**
+ * @brief Simulator configuration, applied to channels initialized afterwards
+ *
+ * @note Frames written to the file start with ws2812_sim_frame_header_t followed by led_count pixels of
+ *       3 bytes in wire order.
+ */
+typedef struct
+{
+    uint32_t history_length; /* Frames kept in memory per channel, 0 keeps only the counters */
+    FILE *record_file;       /* Every frame of every channel is appended to it, NULL disables recording */
+    ws2812_sim_wire_e wire;  /* Write returns once the frame would be on a real strip, or right away */
+} ws2812_sim_config_t;
+
+/**
+ * @brief Header of a frame in the record file
+ */
+typedef struct __attribute__((packed))
+{
+    int64_t timestamp_us;
+    uint32_t wire_us; /* Time the frame would take on a real strip */
+    uint16_t led_count;
+    uint8_t channel;
+} ws2812_sim_frame_header_t;
+
+/**
+ * @brief Frame recorded by the simulator
+ */
+typedef struct
+{
+    ws2812_sim_frame_header_t header;
+    const rgb_color_t *pixels; /* Valid until the channel records history_length newer frames */
+} ws2812_sim_frame_t;
+
+/**
+ * @brief Configures the simulator backend
+ *
+ * @param config simulator configuration
+ */
+void ws2812_sim_configure(const ws2812_sim_config_t *config);
+
+/**
+ * @brief Get number of frames written to the channel since it was initialized
+ *
+ * @param channel channel index
+ * @return frame count, 0 for unknown channel
+ */
+uint32_t ws2812_sim_get_frame_count(uint8_t channel);
+
+/**
+ * @brief Get one of the frames kept in memory
+ *
+ * @param channel channel index
+ * @param age 0 for the latest frame, 1 for the previous one...
+ * @param frame pointer where the frame is stored
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if the frame is not kept in memory
+ */
+esp_err_t ws2812_sim_get_frame(uint8_t channel, uint32_t age, ws2812_sim_frame_t *frame);
+
+#endif /* WS2812_SIM_H_ */
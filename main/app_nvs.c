@@ -13,6 +13,12 @@ static const char *TAG = "nvs";
 /* NVS namespace used for station mode credentials */
 const char *app_nvs_sta_credentials_namespace = "sta_creds";
 
+/* NVS namespace used for led strip configuration */
+const char *app_nvs_strip_config_namespace = "strip_cfg";
+
+/* NVS namespace used for the OTA manifest URL */
+const char *app_nvs_ota_namespace = "ota_pull";
+
 esp_err_t app_nvs_save_sta_creds()
 {
 
@@ -131,4 +137,244 @@ esp_err_t app_nvs_clear_sta_creds()
     printf("app_nvs_clear_sta_creds: Returned ESP_OK\n");
 
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t app_nvs_save_sta_fast_connect(const app_nvs_sta_fast_connect_t *fast)
+{
+    ESP_LOGI(TAG, "app_nvs_save_sta_fast_connect: Saving station access point to flash");
+
+    nvs_handle handle;
+    esp_err_t esp_err = nvs_open(app_nvs_sta_credentials_namespace, NVS_READWRITE, &handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_sta_fast_connect: Error (%s) opening nvs handle\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    esp_err = nvs_set_blob(handle, "fast_connect", fast, sizeof(app_nvs_sta_fast_connect_t));
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_sta_fast_connect: Error (%s) setting access point to NVS\n", esp_err_to_name(esp_err));
+        nvs_close(handle);
+        return esp_err;
+    }
+
+    esp_err = nvs_commit(handle);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_sta_fast_connect: Error (%s) committing access point to NVS\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    return ESP_OK;
+}
+
+bool app_nvs_load_sta_fast_connect(app_nvs_sta_fast_connect_t *fast)
+{
+    nvs_handle handle;
+    if (nvs_open(app_nvs_sta_credentials_namespace, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    size_t fast_size = sizeof(app_nvs_sta_fast_connect_t);
+    esp_err_t esp_err = nvs_get_blob(handle, "fast_connect", fast, &fast_size);
+    nvs_close(handle);
+    if (esp_err != ESP_OK || fast_size != sizeof(app_nvs_sta_fast_connect_t))
+    {
+        printf("app_nvs_load_sta_fast_connect: Error (%s) no station access point found in NVS\n",
+               esp_err_to_name(esp_err));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Build NVS key of the strip channel configuration, channel 0 keeps the key of single-strip firmware
+ */
+static void app_nvs_strip_config_key(uint8_t channel, char *key, size_t key_size)
+{
+    if (channel == 0)
+    {
+        snprintf(key, key_size, "config");
+    }
+    else
+    {
+        snprintf(key, key_size, "config%u", channel);
+    }
+}
+
+esp_err_t app_nvs_save_strip_config(uint8_t channel, const ws2812_strip_config_t *config)
+{
+    ESP_LOGI(TAG, "app_nvs_save_strip_config: Saving led strip %u configuration to flash", channel);
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    app_nvs_strip_config_key(channel, key, sizeof(key));
+
+    nvs_handle handle;
+    esp_err_t esp_err = nvs_open(app_nvs_strip_config_namespace, NVS_READWRITE, &handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_strip_config: Error (%s) opening nvs handle\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    esp_err = nvs_set_blob(handle, key, config, sizeof(ws2812_strip_config_t));
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_strip_config: Error (%s) setting strip configuration to NVS\n", esp_err_to_name(esp_err));
+        nvs_close(handle);
+        return esp_err;
+    }
+
+    esp_err = nvs_commit(handle);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_strip_config: Error (%s) committing strip configuration to NVS\n",
+               esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    return ESP_OK;
+}
+
+bool app_nvs_load_strip_config(uint8_t channel, ws2812_strip_config_t *config)
+{
+    ESP_LOGI(TAG, "app_nvs_load_strip_config: Loading led strip %u configuration from flash", channel);
+    ws2812_default_strip_config(config);
+
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    app_nvs_strip_config_key(channel, key, sizeof(key));
+
+    nvs_handle handle;
+    if (nvs_open(app_nvs_strip_config_namespace, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    /* Configurations saved by older firmware are shorter, the missing fields keep their defaults */
+    ws2812_strip_config_t saved_config = *config;
+    size_t config_size = sizeof(saved_config);
+    esp_err_t esp_err = nvs_get_blob(handle, key, &saved_config, &config_size);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_load_strip_config: Error (%s) no strip %u configuration found in NVS\n",
+               esp_err_to_name(esp_err), channel);
+        return false;
+    }
+    if (ws2812_validate_strip_config(&saved_config) != ESP_OK)
+    {
+        printf("app_nvs_load_strip_config: invalid strip %u configuration in NVS, using defaults\n", channel);
+        return false;
+    }
+
+    *config = saved_config;
+    printf("app_nvs_load_strip_config: found strip %u configuration: %u pixels on GPIO %u\n", channel,
+           config->led_count, config->gpio);
+    return true;
+}
+
+esp_err_t app_nvs_save_ota_url(const char *url)
+{
+    ESP_LOGI(TAG, "app_nvs_save_ota_url: Saving OTA manifest URL to flash");
+
+    nvs_handle handle;
+    esp_err_t esp_err = nvs_open(app_nvs_ota_namespace, NVS_READWRITE, &handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_ota_url: Error (%s) opening nvs handle\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    esp_err = nvs_set_str(handle, "url", url);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_ota_url: Error (%s) setting OTA URL to NVS\n", esp_err_to_name(esp_err));
+        nvs_close(handle);
+        return esp_err;
+    }
+
+    esp_err = nvs_commit(handle);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_ota_url: Error (%s) committing OTA URL to NVS\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    return ESP_OK;
+}
+
+bool app_nvs_load_ota_url(char *url, size_t size)
+{
+    nvs_handle handle;
+    if (nvs_open(app_nvs_ota_namespace, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    esp_err_t esp_err = nvs_get_str(handle, "url", url, &size);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_load_ota_url: Error (%s) no OTA URL found in NVS\n", esp_err_to_name(esp_err));
+        return false;
+    }
+
+    return url[0] != '\0';
+}
+
+esp_err_t app_nvs_save_lamp_state(const ws2812_lamp_state_t *state)
+{
+    ESP_LOGI(TAG, "app_nvs_save_lamp_state: Saving lamp state to flash");
+
+    nvs_handle handle;
+    esp_err_t esp_err = nvs_open(app_nvs_strip_config_namespace, NVS_READWRITE, &handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_lamp_state: Error (%s) opening nvs handle\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    esp_err = nvs_set_blob(handle, "lamp", state, sizeof(ws2812_lamp_state_t));
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_lamp_state: Error (%s) setting lamp state to NVS\n", esp_err_to_name(esp_err));
+        nvs_close(handle);
+        return esp_err;
+    }
+
+    esp_err = nvs_commit(handle);
+    nvs_close(handle);
+    if (esp_err != ESP_OK)
+    {
+        printf("app_nvs_save_lamp_state: Error (%s) committing lamp state to NVS\n", esp_err_to_name(esp_err));
+        return esp_err;
+    }
+
+    return ESP_OK;
+}
+
+bool app_nvs_load_lamp_state(ws2812_lamp_state_t *state)
+{
+    nvs_handle handle;
+    if (nvs_open(app_nvs_strip_config_namespace, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    size_t state_size = sizeof(ws2812_lamp_state_t);
+    esp_err_t esp_err = nvs_get_blob(handle, "lamp", state, &state_size);
+    nvs_close(handle);
+    if (esp_err != ESP_OK || state_size != sizeof(ws2812_lamp_state_t))
+    {
+        printf("app_nvs_load_lamp_state: Error (%s) no lamp state found in NVS\n", esp_err_to_name(esp_err));
+        return false;
+    }
+
+    return true;
+}
@@ -2,9 +2,13 @@
 #define APP_NVS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "esp_err.h"
 
+#include "ws2812_api.h"
+
 /**
  * @brief Saves station mode Wi-Fi credentials to NVS.
  *
@@ -25,4 +29,85 @@ bool app_nvs_load_sta_creds();
  * @return ESP_OK
  */
 esp_err_t app_nvs_clear_sta_creds();
+
+/* Length of the WPA2 pairwise master key */
+#define APP_NVS_PMK_LEN 32
+
+/**
+ * @brief Access point of the last successful station connection, used to connect without a scan
+ */
+typedef struct
+{
+    uint8_t bssid[6];
+    uint8_t channel;
+    bool has_pmk;                 /* pmk is valid, otherwise the driver derives it from the password */
+    uint8_t pmk[APP_NVS_PMK_LEN]; /* WPA2 PSK derived from the password and the SSID */
+} app_nvs_sta_fast_connect_t;
+
+/**
+ * @brief Saves the access point of the last station connection to NVS, it is cleared with the credentials.
+ *
+ * @param fast access point to be saved
+ * @return ESP_OK, otherwise NVS error
+ */
+esp_err_t app_nvs_save_sta_fast_connect(const app_nvs_sta_fast_connect_t *fast);
+
+/**
+ * @brief Loads the access point of the last station connection from NVS.
+ *
+ * @param fast pointer where the access point is loaded
+ * @return true, if a saved access point was found, otherwise false.
+ */
+bool app_nvs_load_sta_fast_connect(app_nvs_sta_fast_connect_t *fast);
+
+/**
+ * @brief Saves led strip channel configuration to NVS, it is applied on the next boot.
+ *
+ * @param channel strip channel index
+ * @param config strip configuration to be saved, led_count 0 disables channels above 0
+ * @return ESP_OK, otherwise NVS error
+ */
+esp_err_t app_nvs_save_strip_config(uint8_t channel, const ws2812_strip_config_t *config);
+
+/**
+ * @brief Loads led strip channel configuration from NVS.
+ *
+ * @param channel strip channel index
+ * @param config pointer where configuration is loaded, filled with defaults if nothing valid is saved
+ * @return true, if saved configuration was found, otherwise false.
+ */
+bool app_nvs_load_strip_config(uint8_t channel, ws2812_strip_config_t *config);
+
+/**
+ * @brief Saves the manifest URL of pull OTA updates to NVS.
+ *
+ * @param url manifest URL
+ * @return ESP_OK, otherwise NVS error
+ */
+esp_err_t app_nvs_save_ota_url(const char *url);
+
+/**
+ * @brief Loads the manifest URL of pull OTA updates from NVS.
+ *
+ * @param url buffer where the null-terminated URL is loaded
+ * @param size size of the buffer
+ * @return true, if a saved URL was found and fits the buffer, otherwise false.
+ */
+bool app_nvs_load_ota_url(char *url, size_t size);
+
+/**
+ * @brief Saves the lamp state to NVS, it is restored on the next boot.
+ *
+ * @param state brightness and running effects to be saved
+ * @return ESP_OK, otherwise NVS error
+ */
+esp_err_t app_nvs_save_lamp_state(const ws2812_lamp_state_t *state);
+
+/**
+ * @brief Loads the lamp state saved by app_nvs_save_lamp_state() from NVS.
+ *
+ * @param state pointer where the lamp state is loaded
+ * @return true, if a saved lamp state was found, otherwise false.
+ */
+bool app_nvs_load_lamp_state(ws2812_lamp_state_t *state);
 #endif /* APP_NVS_H_ */
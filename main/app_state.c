@@ -0,0 +1,163 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_state.h"
+#include "tasks_common.h"
+#include "ws2812_api.h"
+
+/* Tag used for ESP serial console messages */
+static const char *TAG = "app_state";
+
+/**
+ * @brief Subscriber entry, unused while subscriber is NULL
+ */
+typedef struct
+{
+    app_state_subscriber_t subscriber;
+    void *ctx;
+    uint32_t topics;
+} app_state_subscription_t;
+
+/* State and subscribers, written by any task under the lock */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static app_state_t s_state = {
+    .version = 0, .wifi_connect_status = APP_WIFI_STATUS_NONE, .fw_update_status = OTA_UPDATE_PENDING};
+static app_state_subscription_t s_subscriptions[APP_STATE_MAX_SUBSCRIBERS];
+
+/* Task notifying the subscribers, its notification value collects the changed topics */
+static TaskHandle_t s_task = NULL;
+
+/**
+ * @brief Notifies the state task of changed topics, called with the state updated
+ */
+static void app_state_notify(uint32_t topics)
+{
+    TaskHandle_t task = s_task;
+    if (task != NULL)
+    {
+        xTaskNotify(task, topics, eSetBits);
+    }
+}
+
+/**
+ * @brief Lamp state listener, called by the render task
+ */
+static void app_state_lamp_listener()
+{
+    app_state_publish(APP_STATE_TOPIC_LAMP);
+}
+
+/**
+ * @brief State task, calls the subscribers of the changed topics with one snapshot
+ *
+ * @param pvParameters parameter which can be passed to the task
+ */
+static void app_state_task(void *pvParameters)
+{
+    app_state_subscription_t subscriptions[APP_STATE_MAX_SUBSCRIBERS];
+    app_state_t state;
+
+    for (;;)
+    {
+        uint32_t topics = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &topics, portMAX_DELAY);
+
+        portENTER_CRITICAL(&s_lock);
+        state = s_state;
+        memcpy(subscriptions, s_subscriptions, sizeof(subscriptions));
+        portEXIT_CRITICAL(&s_lock);
+
+        for (uint32_t i = 0; i < APP_STATE_MAX_SUBSCRIBERS; ++i)
+        {
+            if (subscriptions[i].subscriber != NULL && (subscriptions[i].topics & topics) != 0)
+            {
+                subscriptions[i].subscriber(&state, subscriptions[i].topics & topics, subscriptions[i].ctx);
+            }
+        }
+    }
+}
+
+esp_err_t app_state_init(void)
+{
+    if (s_task != NULL)
+    {
+        return ESP_OK;
+    }
+    if (xTaskCreatePinnedToCore(app_state_task, "app_state_task", APP_STATE_TASK_STACK_SIZE, NULL,
+                                APP_STATE_TASK_PRIORITY, &s_task, APP_STATE_TASK_CORE_ID) != pdPASS)
+    {
+        ESP_LOGE(TAG, "app_state_init: state task could not be created");
+        return ESP_ERR_NO_MEM;
+    }
+    ws2812_set_state_listener(app_state_lamp_listener);
+    return ESP_OK;
+}
+
+void app_state_get(app_state_t *state)
+{
+    portENTER_CRITICAL(&s_lock);
+    *state = s_state;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void app_state_set_wifi_connect_status(app_wifi_connect_status_e status)
+{
+    ESP_LOGI(TAG, "wifi_connect_status: %d", status);
+    portENTER_CRITICAL(&s_lock);
+    s_state.wifi_connect_status = status;
+    ++s_state.version;
+    portEXIT_CRITICAL(&s_lock);
+    app_state_notify(APP_STATE_TOPIC_WIFI);
+}
+
+void app_state_set_fw_update_status(int status)
+{
+    ESP_LOGI(TAG, "fw_update_status: %d", status);
+    portENTER_CRITICAL(&s_lock);
+    s_state.fw_update_status = status;
+    ++s_state.version;
+    portEXIT_CRITICAL(&s_lock);
+    app_state_notify(APP_STATE_TOPIC_OTA);
+}
+
+void app_state_publish(uint32_t topics)
+{
+    portENTER_CRITICAL(&s_lock);
+    ++s_state.version;
+    portEXIT_CRITICAL(&s_lock);
+    app_state_notify(topics);
+}
+
+esp_err_t app_state_subscribe(uint32_t topics, app_state_subscriber_t subscriber, void *ctx)
+{
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < APP_STATE_MAX_SUBSCRIBERS; ++i)
+    {
+        if (s_subscriptions[i].subscriber == NULL)
+        {
+            s_subscriptions[i] = (app_state_subscription_t){.subscriber = subscriber, .ctx = ctx, .topics = topics};
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+void app_state_unsubscribe(app_state_subscriber_t subscriber, void *ctx)
+{
+    portENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < APP_STATE_MAX_SUBSCRIBERS; ++i)
+    {
+        if (s_subscriptions[i].subscriber == subscriber && s_subscriptions[i].ctx == ctx)
+        {
+            s_subscriptions[i].subscriber = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,109 @@
+#ifndef APP_STATE_H_
+#define APP_STATE_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Firmware update status */
+#define OTA_UPDATE_PENDING 0
+#define OTA_UPDATE_SUCCESS 1
+#define OTA_UPDATE_FAILED -1  /* Image rejected by its hash or validation, or the flash or partition failed */
+#define OTA_UPDATE_PARTIAL 2  /* Raw image incomplete in the flash, the upload continues at the resume offset */
+
+/* Subscribers of the state store, e.g. the /ws push */
+#define APP_STATE_MAX_SUBSCRIBERS 4
+
+/**
+ * @brief Wifi connection states
+ */
+typedef enum app_wifi_connect_status
+{
+    APP_WIFI_STATUS_NONE = 0,
+    APP_WIFI_STATUS_CONNECTING,
+    APP_WIFI_STATUS_CONNECT_FAIL,
+    APP_WIFI_STATUS_CONNECT_SUCCESS,
+    APP_WIFI_STATUS_DISCONNECTED,
+} app_wifi_connect_status_e;
+
+/**
+ * @brief Topics of the application state, subscribers are notified of the topics that changed
+ */
+typedef enum app_state_topic
+{
+    APP_STATE_TOPIC_WIFI = 1 << 0, /* Wi-Fi connect status */
+    APP_STATE_TOPIC_OTA = 1 << 1,  /* Firmware update status, OTA writer progress and pull state */
+    APP_STATE_TOPIC_LAMP = 1 << 2, /* Lamp state of ws2812_get_lamp_state() */
+    APP_STATE_TOPIC_ALL = APP_STATE_TOPIC_WIFI | APP_STATE_TOPIC_OTA | APP_STATE_TOPIC_LAMP,
+} app_state_topic_e;
+
+/**
+ * @brief Snapshot of the application state
+ */
+typedef struct
+{
+    uint32_t version; /* Incremented by every publish, a snapshot with the same version has the same state */
+    app_wifi_connect_status_e wifi_connect_status;
+    int fw_update_status; /* OTA_UPDATE_PENDING, OTA_UPDATE_SUCCESS, OTA_UPDATE_FAILED or OTA_UPDATE_PARTIAL */
+} app_state_t;
+
+/**
+ * @brief Subscriber of state changes, called from the state task
+ *
+ * @param state snapshot taken after the changes
+ * @param topics mask of the app_state_topic_e topics that changed since the last call, only subscribed ones
+ * @param ctx context given to app_state_subscribe()
+ */
+typedef void (*app_state_subscriber_t)(const app_state_t *state, uint32_t topics, void *ctx);
+
+/**
+ * @brief Starts the state task which notifies the subscribers.
+ *
+ * @note Publishing never blocks: the state is updated under a spinlock and the changed topics are set as bits of
+ *       the task notification, so publishes from the Wi-Fi event path or the render task neither wait for a queue
+ *       nor get lost. Changes published while the subscribers run are coalesced into the next notification.
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM if the task could not be created
+ */
+esp_err_t app_state_init(void);
+
+/**
+ * @brief Copies a consistent snapshot of the state
+ *
+ * @param state pointer where the snapshot is copied
+ */
+void app_state_get(app_state_t *state);
+
+/**
+ * @brief Publishes a new Wi-Fi connect status, never blocks
+ */
+void app_state_set_wifi_connect_status(app_wifi_connect_status_e status);
+
+/**
+ * @brief Publishes a new firmware update status, never blocks
+ */
+void app_state_set_fw_update_status(int status);
+
+/**
+ * @brief Publishes a change of state kept by its module, e.g. the lamp state or the OTA progress, never blocks
+ *
+ * @param topics mask of app_state_topic_e topics
+ */
+void app_state_publish(uint32_t topics);
+
+/**
+ * @brief Adds a subscriber
+ *
+ * @param topics mask of the app_state_topic_e topics the subscriber is notified of
+ * @param subscriber function called from the state task, it must not block for long
+ * @param ctx context passed to the subscriber
+ * @return ESP_OK, ESP_ERR_NO_MEM if APP_STATE_MAX_SUBSCRIBERS are subscribed
+ */
+esp_err_t app_state_subscribe(uint32_t topics, app_state_subscriber_t subscriber, void *ctx);
+
+/**
+ * @brief Removes a subscriber, a notification running at the same time may still call it once
+ */
+void app_state_unsubscribe(app_state_subscriber_t subscriber, void *ctx);
+
+#endif /* APP_STATE_H_ */
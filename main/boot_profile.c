@@ -0,0 +1,78 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "boot_profile.h"
+
+/* Tag used for ESP serial console messages */
+static const char *TAG = "boot_profile";
+
+/* Phase names, indexed by boot_phase_e */
+static const char *const s_phase_names[BOOT_PHASE_COUNT] = {
+    "startup", "nvs", "lamp_init", "light_on", "wifi_init", "wifi_start", "http_server", "sta_connect",
+};
+
+/* Spans written by the tasks of the phases */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static boot_profile_phase_t s_phases[BOOT_PHASE_COUNT];
+static bool s_begun[BOOT_PHASE_COUNT] = {[BOOT_PHASE_STARTUP] = true};
+
+void boot_profile_begin(boot_phase_e phase)
+{
+    if (phase >= BOOT_PHASE_COUNT)
+    {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_begun[phase])
+    {
+        s_begun[phase] = true;
+        s_phases[phase].begin_us = now_us;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool boot_profile_end(boot_phase_e phase)
+{
+    if (phase >= BOOT_PHASE_COUNT)
+    {
+        return false;
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    bool ended = false;
+    bool begun;
+    boot_profile_phase_t span;
+    portENTER_CRITICAL(&s_lock);
+    begun = s_begun[phase];
+    if (begun && s_phases[phase].end_us == 0)
+    {
+        s_phases[phase].end_us = now_us;
+        span = s_phases[phase];
+        ended = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ended)
+    {
+        ESP_LOGI(TAG, "%-11s %6lld .. %6lld ms, %6lld us", s_phase_names[phase], span.begin_us / 1000,
+                 span.end_us / 1000, span.end_us - span.begin_us);
+    }
+    return begun;
+}
+
+void boot_profile_get(boot_profile_phase_t *phases)
+{
+    portENTER_CRITICAL(&s_lock);
+    memcpy(phases, s_phases, sizeof(s_phases));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+const char *boot_profile_get_phase_name(boot_phase_e phase)
+{
+    return phase < BOOT_PHASE_COUNT ? s_phase_names[phase] : "unknown";
+}
@@ -0,0 +1,56 @@
+#ifndef BOOT_PROFILE_H_
+#define BOOT_PROFILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Boot phases, several of them run at the same time
+ */
+typedef enum boot_phase
+{
+    BOOT_PHASE_STARTUP = 0, /* Bootloader and IDF startup until app_main(), begins at 0 */
+    BOOT_PHASE_NVS,         /* nvs_flash_init() */
+    BOOT_PHASE_LAMP_INIT,   /* Strip configuration load, init_ws2812() and the restore of the lamp state */
+    BOOT_PHASE_LIGHT_ON,    /* Restored lamp state queued until its first frame is on the strip */
+    BOOT_PHASE_WIFI_INIT,   /* Netif, event loop, Wi-Fi driver and SoftAP configuration */
+    BOOT_PHASE_WIFI_START,  /* esp_wifi_start(), the SoftAP is up at the end */
+    BOOT_PHASE_HTTP_SERVER, /* http_server_start() */
+    BOOT_PHASE_STA_CONNECT, /* Station connect with the saved credentials until the IP is assigned */
+    BOOT_PHASE_COUNT
+} boot_phase_e;
+
+/**
+ * @brief Time span of one phase, esp_timer_get_time() microseconds since boot
+ */
+typedef struct
+{
+    int64_t begin_us;
+    int64_t end_us; /* 0 while the phase runs or if it did not run */
+} boot_profile_phase_t;
+
+/**
+ * @brief Records the begin of a phase, only the first call of each phase is recorded
+ */
+void boot_profile_begin(boot_phase_e phase);
+
+/**
+ * @brief Records the end of a begun phase and logs its span, only the first call of each phase is recorded
+ *
+ * @return true if the phase has ended, false if it has not begun yet
+ */
+bool boot_profile_end(boot_phase_e phase);
+
+/**
+ * @brief Copies the spans of all phases
+ *
+ * @param phases array of BOOT_PHASE_COUNT spans, indexed by boot_phase_e
+ */
+void boot_profile_get(boot_profile_phase_t *phases);
+
+/**
+ * @brief Get the name of a phase, as reported in /bootProfile.json
+ */
+const char *boot_profile_get_phase_name(boot_phase_e phase);
+
+#endif /* BOOT_PROFILE_H_ */
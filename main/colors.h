@@ -4,21 +4,26 @@
 #include <stdint.h>
 
 /**
- * @brief struct with RGB configuration
+ * @brief Packed 8-bit pixel stored in WS2812 wire order (GRB)
  *
- * @note can be accessed via color array or color_rgb struct
+ * @note can be accessed via color array (in wire order) or color_rgb struct
  */
 typedef struct
 {
     union {
-        uint16_t color[3];
+        uint8_t color[3];
         struct
         {
-            uint16_t red, green, blue;
+            uint8_t green, red, blue;
         } color_rgb;
     };
 } rgb_color_t;
 
+/**
+ * @brief Constant initializer of rgb_color_t, usable in static tables
+ */
+#define RGB_COLOR(r, g, b) {.color_rgb = {.green = (g), .red = (r), .blue = (b)}}
+
 /**
  * @brief enum that represents colors
  */
@@ -28,15 +33,24 @@ typedef enum
     color_BLUE,
     color_GREEN,
     color_WHITE,
-    color_WARM_WHITE
+    color_WARM_WHITE,
+    color_COUNT
 } color_e;
 
+/**
+ * @brief Palette of the colors from color_e, indexed by the enum value
+ */
+extern const rgb_color_t color_palette[color_COUNT];
+
 /**
  * @brief convert colors from enum_e to their rgb_color_t representation
  *
  * @param color color that is available in enum
- * @return rgb_color_t color representation
+ * @return rgb_color_t color representation, white for unknown colors
  */
-rgb_color_t color_to_rgb_struct(color_e color);
+static inline rgb_color_t color_to_rgb_struct(color_e color)
+{
+    return (unsigned)color < color_COUNT ? color_palette[color] : color_palette[color_WHITE];
+}
 
 #endif /* COLORS_H_ */
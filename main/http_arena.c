@@ -0,0 +1,116 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "http_arena.h"
+
+/**
+ * @brief Arena of one connection, stored as its session context
+ */
+typedef struct
+{
+    bool used;
+    size_t offset;
+    uint8_t memory[HTTP_ARENA_SIZE] __attribute__((aligned(4)));
+} http_arena_t;
+
+/* Static pool, so the request path never touches the heap */
+static http_arena_t s_arenas[HTTP_ARENA_COUNT];
+
+/* Guards the pool and the statistics, which are read from other tasks */
+static portMUX_TYPE s_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+static http_arena_stats_t s_stats = {.size = HTTP_ARENA_SIZE};
+
+/**
+ * @brief Session context free hook, returns the arena to the pool when the connection closes
+ *
+ * @param ctx arena of the connection
+ */
+static void http_arena_release(void *ctx)
+{
+    http_arena_t *arena = (http_arena_t *)ctx;
+
+    portENTER_CRITICAL(&s_arena_lock);
+    arena->used = false;
+    --s_stats.in_use;
+    portEXIT_CRITICAL(&s_arena_lock);
+}
+
+/**
+ * @brief Returns the arena of the request connection, takes a free one from the pool for a new connection
+ *
+ * @param req HTTP request
+ * @return arena, NULL if the pool is exhausted
+ */
+static http_arena_t *http_arena_of(httpd_req_t *req)
+{
+    if (req->sess_ctx != NULL)
+    {
+        return (http_arena_t *)req->sess_ctx;
+    }
+
+    http_arena_t *arena = NULL;
+    portENTER_CRITICAL(&s_arena_lock);
+    for (uint32_t i = 0; i < HTTP_ARENA_COUNT; ++i)
+    {
+        if (!s_arenas[i].used)
+        {
+            arena = &s_arenas[i];
+            arena->used = true;
+            arena->offset = 0;
+            if (++s_stats.in_use > s_stats.in_use_max)
+            {
+                s_stats.in_use_max = s_stats.in_use;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_arena_lock);
+
+    if (arena != NULL)
+    {
+        req->sess_ctx = arena;
+        req->free_ctx = http_arena_release;
+    }
+    return arena;
+}
+
+void *http_arena_alloc(httpd_req_t *req, size_t size)
+{
+    http_arena_t *arena = http_arena_of(req);
+    size = (size + 3) & ~(size_t)3;
+    if (arena == NULL || size > HTTP_ARENA_SIZE - arena->offset)
+    {
+        portENTER_CRITICAL(&s_arena_lock);
+        ++s_stats.alloc_failures;
+        portEXIT_CRITICAL(&s_arena_lock);
+        return NULL;
+    }
+
+    void *memory = &arena->memory[arena->offset];
+    arena->offset += size;
+
+    portENTER_CRITICAL(&s_arena_lock);
+    if (arena->offset > s_stats.high_water)
+    {
+        s_stats.high_water = arena->offset;
+    }
+    portEXIT_CRITICAL(&s_arena_lock);
+    return memory;
+}
+
+void http_arena_reset(httpd_req_t *req)
+{
+    if (req->sess_ctx != NULL && req->free_ctx == http_arena_release)
+    {
+        ((http_arena_t *)req->sess_ctx)->offset = 0;
+    }
+}
+
+void http_arena_get_stats(http_arena_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_arena_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_arena_lock);
+}
@@ -0,0 +1,53 @@
+#ifndef HTTP_ARENA_H_
+#define HTTP_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_http_server.h"
+
+/* Scratch memory of one connection, sized by the largest handler: /OTApull takes the manifest URL and a JSON reply,
+ * 416 bytes, the high_water of /serverStats.json. The OTA upload receives into ota_writer slots, not the arena */
+#define HTTP_ARENA_SIZE 512
+/* One arena per open socket of the server */
+#define HTTP_ARENA_COUNT 7
+
+/**
+ * @brief Arena usage statistics, used to size HTTP_ARENA_SIZE and the httpd task stack
+ */
+typedef struct
+{
+    uint32_t size;           /* HTTP_ARENA_SIZE */
+    uint32_t high_water;     /* Most bytes one request used since boot */
+    uint32_t in_use;         /* Arenas held by open connections */
+    uint32_t in_use_max;     /* Most arenas held at once since boot */
+    uint32_t alloc_failures; /* Allocations which did not fit the arena */
+} http_arena_stats_t;
+
+/**
+ * @brief Allocates scratch memory from the arena of the request connection.
+ *
+ * @note The connection takes an arena from the static pool on its first allocation and returns it when it
+ *       closes. Memory is valid until the request completes, there is no free.
+ *
+ * @param req HTTP request
+ * @param size number of bytes, rounded up to 4-byte alignment
+ * @return pointer to the memory, NULL if it does not fit the arena or no arena is free
+ */
+void *http_arena_alloc(httpd_req_t *req, size_t size);
+
+/**
+ * @brief Releases all memory allocated for the request, called once its handler returned
+ *
+ * @param req HTTP request
+ */
+void http_arena_reset(httpd_req_t *req);
+
+/**
+ * @brief Get arena usage statistics
+ *
+ * @param stats pointer where statistics are copied
+ */
+void http_arena_get_stats(http_arena_stats_t *stats);
+
+#endif /* HTTP_ARENA_H_ */
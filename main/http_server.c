@@ -1,3 +1,7 @@
+#include <string.h>
+#include <strings.h>
+
+#include "esp_app_desc.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
@@ -8,42 +12,69 @@
 #include "lwip/inet.h"
 #include "sys/param.h"
 
+#include "app_nvs.h"
+#include "app_state.h"
+#include "boot_profile.h"
+#include "http_arena.h"
 #include "http_server.h"
+#include "http_util.h"
+#include "lamp_api.h"
+#include "multipart.h"
+#include "ota_pull.h"
+#include "ota_writer.h"
 #include "tasks_common.h"
+#include "web_assets.h"
 #include "wifi_app.h"
+#include "ws2812_api.h"
 
 /* Tag user for esp serial console log */
 static const char *TAG = "http_server";
 
-/* Firmware update status */
-static int g_fw_update_status = OTA_UPDATE_PENDING;
-
-/* WiFi connect status */
-static int g_wifi_connect_status = HTTP_WIFI_STATUS_NONE;
 /* HTTP server task handle */
 static httpd_handle_t http_server_handle = NULL;
 
-/* HTTP server monitor task handle */
-static TaskHandle_t task_server_http_monitor = NULL;
+/* Longest Content-Type of a firmware upload, multipart/form-data with a boundary of up to 70 characters */
+#define HTTP_SERVER_CONTENT_TYPE_SIZE 128
+/* Smallest receive into an OTA writer slot, a slot with less room left is handed to the flash writer */
+#define HTTP_SERVER_OTA_MIN_RECEIVE 512
+/* Period of the OTA progress pushed to /ws clients during an upload */
+#define HTTP_SERVER_OTA_PUSH_PERIOD_MS 500
+/* Longest state message pushed to /ws clients, the OTA state with its progress */
+#define HTTP_SERVER_WS_MESSAGE_SIZE 448
 
-/* Queue handle used to manipulate the main queue of events */
-static QueueHandle_t http_server_monitor_queue_handle = NULL;
+/* Body of large assets is sent in chunks of two TCP segments, half of the default lwIP send buffer */
+#define HTTP_SERVER_ASSET_CHUNK_SIZE (2 * 1436)
 
-/* Embedded files: JQuery, index.html, ap/css, app.js, favicon.ico files */
-extern const uint8_t jquery_3_6_1_min_js_start[] asm("_binary_jquery_3_6_1_min_js_start");
-extern const uint8_t jquery_3_6_1_min_js_end[] asm("_binary_jquery_3_6_1_min_js_end");
+/**
+ * @brief Asset request handed over from the httpd task to the asset workers
+ */
+typedef struct
+{
+    httpd_req_t *req; /* Async copy of the request, completed by the worker */
+    const web_asset_t *asset;
+} http_server_asset_job_t;
 
-extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t index_html_end[] asm("_binary_index_html_end");
+/* Queue of asset requests, drained by the asset worker tasks */
+static QueueHandle_t http_server_asset_queue_handle = NULL;
 
-extern const uint8_t app_css_start[] asm("_binary_app_css_start");
-extern const uint8_t app_css_end[] asm("_binary_app_css_end");
+/* Sockets of the server, every AP client may hold one async asset transfer and still open new connections */
+#define HTTP_SERVER_MAX_OPEN_SOCKETS (WIFI_AP_MAX_CONNECTIONS + 2)
 
-extern const uint8_t app_js_start[] asm("_binary_app_js_start");
-extern const uint8_t app_js_end[] asm("_binary_app_js_end");
+_Static_assert(HTTP_ARENA_COUNT >= HTTP_SERVER_MAX_OPEN_SOCKETS, "every open socket needs its arena");
 
-extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
-extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_end");
+/* Clients of /ws only listen, longer frames they send close the connection */
+#define HTTP_SERVER_WS_MAX_FRAME 64
+
+/**
+ * @brief State topics pushed to /ws clients, the app_state_topic_e topics
+ */
+typedef enum
+{
+    HTTP_WS_TOPIC_WIFI = APP_STATE_TOPIC_WIFI,
+    HTTP_WS_TOPIC_OTA = APP_STATE_TOPIC_OTA,
+    HTTP_WS_TOPIC_LAMP = APP_STATE_TOPIC_LAMP,
+    HTTP_WS_TOPIC_ALL = APP_STATE_TOPIC_ALL,
+} http_server_ws_topic_e;
 
 /**
  * @brief ESP32 timer configuration passed to esp_timer_create
@@ -52,14 +83,16 @@ const esp_timer_create_args_t fw_update_reset_args = {.callback = &http_server_f
                                                       .arg = NULL,
                                                       .dispatch_method = ESP_TIMER_TASK,
                                                       .name = "fw_update_reset"};
-esp_timer_handle_t fw_update_reset;
+esp_timer_handle_t fw_update_reset = NULL;
 
 /**
- * @brief Checks the g_fw_update_status and creates the fw_update_reset timer if g_fw_update_status is true.
+ * @brief Checks the firmware update status and creates the fw_update_reset timer if the update was successful.
+ *
+ * @param fw_update_status firmware update status of the state snapshot
  */
-static void http_server_fw_update_timer()
+static void http_server_fw_update_timer(int fw_update_status)
 {
-    if (g_fw_update_status == OTA_UPDATE_SUCCESS)
+    if (fw_update_status == OTA_UPDATE_SUCCESS && fw_update_reset == NULL)
     {
         ESP_LOGI(TAG, "http_server_fw_update_timer: FW updated successful, starting the FW update reset timer");
 
@@ -68,182 +101,480 @@ static void http_server_fw_update_timer()
         const uint32_t timer_seconds_ms = 8 * 10000;
         ESP_ERROR_CHECK(esp_timer_start_once(fw_update_reset, timer_seconds_ms));
     }
-    else
+    else if (fw_update_status == OTA_UPDATE_FAILED)
     {
         ESP_LOGI(TAG, "http_server_fw_update_timer: FW updated unsuccessful");
     }
+    else if (fw_update_status == OTA_UPDATE_PARTIAL)
+    {
+        ESP_LOGI(TAG, "http_server_fw_update_timer: FW upload continues at byte %lu", ota_writer_get_written());
+    }
 }
 
 /**
- * @brief HTTP server monitor task used to track events of the HTTP server
+ * @brief Writes the Wi-Fi connect status members, shared by /wifiConnectStatus and /ws
+ */
+static void http_server_write_wifi_status(http_json_writer_t *w, const app_state_t *state)
+{
+    http_json_member_int(w, "wifi_connect_status", state->wifi_connect_status);
+}
+
+/**
+ * @brief Writes the OTA status members, shared by /OTAstatus and /ws
+ */
+static void http_server_write_ota_status(http_json_writer_t *w, const app_state_t *state)
+{
+    ota_writer_stats_t stats;
+    ota_writer_get_stats(&stats);
+
+    http_json_member_int(w, "ota_update_status", state->fw_update_status);
+    if (state->fw_update_status == OTA_UPDATE_PARTIAL)
+    {
+        http_json_member_uint(w, "resume_offset", ota_writer_get_written());
+    }
+    http_json_member_string(w, "compile_time", __TIME__);
+    http_json_member_string(w, "compile_date", __DATE__);
+    http_json_member_string(w, "version", esp_app_get_description()->version);
+    http_json_member_string(w, "pull", ota_pull_get_state_name(ota_pull_get_state()));
+
+    /* Progress of the running or the last upload, rates in bytes/s */
+    http_json_key(w, "progress");
+    http_json_object_begin(w);
+    http_json_member_bool(w, "active", stats.active);
+    http_json_member_uint(w, "total", stats.total);
+    http_json_member_uint(w, "received", stats.received);
+    http_json_member_uint(w, "written", stats.written);
+    http_json_member_uint(w, "network_wait_ms", stats.network_wait_ms);
+    http_json_member_uint(w, "receive_stall_ms", stats.receive_stall_ms);
+    http_json_member_uint(w, "flash_write_ms", stats.flash_write_ms);
+    http_json_member_uint(w, "elapsed_ms", stats.elapsed_ms);
+    http_json_member_uint(w, "rate", stats.rate);
+    http_json_member_uint(w, "average_rate", stats.average_rate);
+    http_json_object_end(w);
+}
+
+/**
+ * @brief Writes the lamp state members
+ */
+static void http_server_write_lamp_state(http_json_writer_t *w)
+{
+    ws2812_lamp_state_t lamp;
+    ws2812_get_lamp_state(&lamp);
+
+    http_json_member_uint(w, "brightness", lamp.brightness);
+    http_json_key(w, "effects");
+    http_json_array_begin(w);
+    for (uint8_t c = 0; c < lamp.channel_count; ++c)
+    {
+        http_json_int(w, lamp.effect[c]);
+    }
+    http_json_array_end(w);
+}
+
+/**
+ * @brief Prints the state of one topic as JSON, keys are the same as in the replies of the status handlers
  *
- * @param pvParameter parameter which can be passed to task
+ * @param buffer output buffer
+ * @param size size of the buffer
+ * @param topic one of http_server_ws_topic_e topics
+ * @return length of the message, 0 if it does not fit the buffer
  */
-static void http_server_monitor(void *pvParameter)
+static size_t http_server_print_ws_state(char *buffer, size_t size, http_server_ws_topic_e topic)
 {
-    http_server_queue_message_t msg;
-    for (;;)
+    http_json_writer_t w;
+    app_state_t state;
+
+    app_state_get(&state);
+    http_json_init(&w, NULL, buffer, size);
+    http_json_object_begin(&w);
+    switch (topic)
+    {
+    case HTTP_WS_TOPIC_WIFI:
+        http_json_member_string(&w, "type", "wifi");
+        http_server_write_wifi_status(&w, &state);
+        break;
+
+    case HTTP_WS_TOPIC_OTA:
+        http_json_member_string(&w, "type", "ota");
+        http_server_write_ota_status(&w, &state);
+        break;
+
+    default:
+        http_json_member_string(&w, "type", "lamp");
+        http_server_write_lamp_state(&w);
+        break;
+    }
+    http_json_object_end(&w);
+    return http_json_finish(&w) == ESP_OK ? w.len : 0;
+}
+
+/**
+ * @brief Sends the state of the topics to one /ws client, runs in the httpd task
+ *
+ * @param fd socket of the client
+ * @param topics mask of http_server_ws_topic_e topics
+ */
+static void http_server_ws_send_state(int fd, uint32_t topics)
+{
+    char message[HTTP_SERVER_WS_MESSAGE_SIZE];
+
+    for (uint32_t topic = 1; topic <= HTTP_WS_TOPIC_LAMP; topic <<= 1)
     {
-        if (xQueueReceive(http_server_monitor_queue_handle, &msg, portMAX_DELAY))
+        if ((topics & topic) == 0)
         {
-            switch (msg.messageID)
-            {
-            case HTTP_MSG_WIFI_CONNECT_INIT: {
-                ESP_LOGI(TAG, "HTTP_MSG_WIFI_CONNECT_INIT");
-                g_wifi_connect_status = HTTP_WIFI_STATUS_CONNECTING;
-            }
-            break;
-            case HTTP_MSG_WIFI_CONNECT_SUCCESS: {
-                ESP_LOGI(TAG, "HTTP_MSG_WIFI_CONNECT_SUCCESS");
-                g_wifi_connect_status = HTTP_WIFI_STATUS_CONNECT_SUCCESS;
-            }
-            break;
-            case HTTP_MSG_WIFI_USER_DISCONNECT: {
-                ESP_LOGI(TAG, "HTTP_MSG_USER_DISCONNECT");
-                g_wifi_connect_status = HTTP_WIFI_STATUS_DISCONNECTED;
-            }
-            break;
+            continue;
+        }
+        size_t len = http_server_print_ws_state(message, sizeof(message), (http_server_ws_topic_e)topic);
+        httpd_ws_frame_t frame = {.final = true, .type = HTTPD_WS_TYPE_TEXT, .payload = (uint8_t *)message, .len = len};
+        if (httpd_ws_send_frame_async(http_server_handle, fd, &frame) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "/ws: push to socket %d failed", fd);
+            return;
+        }
+    }
+}
 
-            case HTTP_MSG_WIFI_CONNECT_FAIL: {
-                ESP_LOGI(TAG, "HTTP_MSG_WIFI_CONNECT_FAIL");
-                g_wifi_connect_status = HTTP_WIFI_STATUS_CONNECT_FAIL;
-            }
-            break;
-            case HTTP_MSG_OTA_UPDATE_SUCCESSFUL: {
-                ESP_LOGI(TAG, "HTTP_MSG_OTA_UPDATE_SUCCESSFUL");
-                g_fw_update_status = OTA_UPDATE_SUCCESS;
-                http_server_fw_update_timer();
-            }
-            break;
-            case HTTP_MSG_OTA_UPDATE_FAILED: {
-                ESP_LOGI(TAG, "HTTP_MSG_OTA_UPDATE_FAILED");
-                g_fw_update_status = OTA_UPDATE_FAILED;
-            }
-            break;
+/**
+ * @brief Work item of the httpd task, sends the state of the topics to every /ws client
+ *
+ * @param arg mask of http_server_ws_topic_e topics
+ */
+static void http_server_ws_broadcast_work(void *arg)
+{
+    size_t fd_count = HTTP_SERVER_MAX_OPEN_SOCKETS;
+    int fds[HTTP_SERVER_MAX_OPEN_SOCKETS];
 
-            default:
-                break;
-            }
+    if (http_server_handle == NULL || httpd_get_client_list(http_server_handle, &fd_count, fds) != ESP_OK)
+    {
+        return;
+    }
+    for (size_t i = 0; i < fd_count; ++i)
+    {
+        if (httpd_ws_get_fd_info(http_server_handle, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET)
+        {
+            http_server_ws_send_state(fds[i], (uint32_t)(uintptr_t)arg);
         }
     }
 }
 
 /**
- * @brief Sends the message to monitor server queue
+ * @brief Work item of the httpd task, sends the whole state to a new /ws client
  *
- * @param messageID
- * @return BaseType_t
+ * @param arg socket of the client
  */
-BaseType_t http_server_monitor_send_message(http_server_message_e messageID)
+static void http_server_ws_snapshot_work(void *arg)
 {
-    http_server_queue_message_t message = {.messageID = messageID};
-    return xQueueSend(http_server_monitor_queue_handle, &message, portMAX_DELAY);
+    http_server_ws_send_state((int)(intptr_t)arg, HTTP_WS_TOPIC_ALL);
 }
 
 /**
- * @brief Jquery get handler requested when accessing to the web page.
+ * @brief Pushes the state of the topics to all /ws clients.
  *
- * @param req HTTP request for which uri is need to be handled.
- * @return ESP_OK
+ * @note Frames are sent by the httpd task, so they never interleave with the responses it sends.
+ *
+ * @param topics mask of http_server_ws_topic_e topics
  */
-static esp_err_t http_server_jquery_handler(httpd_req_t *req)
+static void http_server_ws_push(uint32_t topics)
 {
-    ESP_LOGI(TAG, "Jquery requested");
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)jquery_3_6_1_min_js_start, jquery_3_6_1_min_js_end - jquery_3_6_1_min_js_start);
+    if (http_server_handle != NULL)
+    {
+        httpd_queue_work(http_server_handle, http_server_ws_broadcast_work, (void *)(uintptr_t)topics);
+    }
+}
 
-    return ESP_OK;
+/**
+ * @brief State subscriber, pushes the changed topics to /ws clients and restarts into a new firmware
+ */
+static void http_server_state_subscriber(const app_state_t *state, uint32_t topics, void *ctx)
+{
+    http_server_ws_push(topics);
+    if (topics & APP_STATE_TOPIC_OTA)
+    {
+        http_server_fw_update_timer(state->fw_update_status);
+    }
 }
 
 /**
- * @brief Sends the index.html page.
+ * @brief Finds the embedded asset of the request path, query string is ignored.
  *
- * @param req HTTP request for which uri is need to be handled.
- * @return ESP_OK
+ * @param uri request uri.
+ * @return asset, NULL if there is no such asset.
  */
-static esp_err_t http_server_index_html_handler(httpd_req_t *req)
+static const web_asset_t *http_server_find_asset(const char *uri)
 {
-    ESP_LOGI(TAG, "index.html requested");
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char *)index_html_start, index_html_end - index_html_start);
-
-    return ESP_OK;
+    size_t path_length = strcspn(uri, "?");
+    for (size_t i = 0; i < web_assets_count; ++i)
+    {
+        if (strlen(web_assets[i].path) == path_length && strncmp(web_assets[i].path, uri, path_length) == 0)
+        {
+            return &web_assets[i];
+        }
+    }
+    return NULL;
 }
 
 /**
- * @brief app.css get handler is requested when accessing to th web page.
+ * @brief Sends the asset with ETag and Cache-Control headers, the body is streamed in chunks.
  *
- * @param req HTTP request for which uri is need to be handled.
- * @return ESP_OK
+ * @note If-None-Match matching the ETag is answered with 304 Not Modified without the body. The sending task
+ *       yields after every chunk, so transfers running in other asset workers are interleaved.
+ *
+ * @param req HTTP request, the original one or its async copy.
+ * @param asset asset to be sent.
+ * @return ESP_OK, ESP_FAIL if the client did not take the data and the connection has to be closed
  */
-static esp_err_t http_server_app_css_handler(httpd_req_t *req)
+static esp_err_t http_server_send_asset(httpd_req_t *req, const web_asset_t *asset)
 {
-    ESP_LOGI(TAG, "app.css requested");
-    httpd_resp_set_type(req, "text/css");
-    httpd_resp_send(req, (const char *)app_css_start, app_css_end - app_css_start);
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+
+    char if_none_match[64];
+    if (http_header_get_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        (strstr(if_none_match, asset->etag) != NULL || strcmp(if_none_match, "*") == 0))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, asset->mime);
+    httpd_resp_set_hdr(req, "Content-Encoding", asset->encoding);
+    if (asset->len <= HTTP_SERVER_ASSET_CHUNK_SIZE)
+    {
+        httpd_resp_send(req, (const char *)asset->data, asset->len);
+        return ESP_OK;
+    }
+
+    for (size_t offset = 0; offset < asset->len; offset += HTTP_SERVER_ASSET_CHUNK_SIZE)
+    {
+        size_t length = MIN(HTTP_SERVER_ASSET_CHUNK_SIZE, asset->len - offset);
+        if (httpd_resp_send_chunk(req, (const char *)asset->data + offset, length) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "%s: client stopped receiving after %u bytes", asset->path, (unsigned)offset);
+            return ESP_FAIL;
+        }
+        taskYIELD();
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
 
     return ESP_OK;
 }
 
 /**
- * @brief app.js get handler is requested when accessing to th web page.
+ * @brief Asset worker task, streams queued asset requests so that a slow client does not hold the httpd task.
  *
- * @param req HTTP request for which uri is need to be handled.
- * @return ESP_OK
+ * @param pvParameters parameter which can be passed to the task
  */
-static esp_err_t http_server_app_js_handler(httpd_req_t *req)
+static void http_server_asset_worker(void *pvParameters)
 {
-    ESP_LOGI(TAG, "app.css requested");
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char *)app_js_start, app_js_end - app_js_start);
+    http_server_asset_job_t job;
 
-    return ESP_OK;
+    for (;;)
+    {
+        if (xQueueReceive(http_server_asset_queue_handle, &job, portMAX_DELAY) == pdTRUE)
+        {
+            if (http_server_send_asset(job.req, job.asset) != ESP_OK)
+            {
+                httpd_sess_trigger_close(job.req->handle, httpd_req_to_sockfd(job.req));
+            }
+            httpd_req_async_handler_complete(job.req);
+        }
+    }
 }
 
 /**
- * @brief Sends the .ico (icon) file when accessing to the page
+ * @brief Static asset GET handler, serves every path of the generated web_assets table.
+ *
+ * @note Large assets are handed over to the asset workers, so the httpd task is free to accept other clients.
+ *       If every worker is busy and the queue is full the asset is sent by the httpd task itself.
  *
  * @param req HTTP request for which uri is need to be handled.
- * @return ESP_OK
+ * @return ESP_OK, ESP_FAIL to close the connection
  */
-static esp_err_t http_server_favicon_ico_handler(httpd_req_t *req)
+static esp_err_t http_server_asset_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "favicon.ico requested");
+    const web_asset_t *asset = http_server_find_asset(req->uri);
+    if (asset == NULL)
+    {
+        ESP_LOGI(TAG, "%s not found", req->uri);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        return ESP_OK;
+    }
+
+    httpd_req_t *async_req = NULL;
+    if (asset->len > HTTP_SERVER_ASSET_CHUNK_SIZE && httpd_req_async_handler_begin(req, &async_req) == ESP_OK)
+    {
+        http_server_asset_job_t job = {.req = async_req, .asset = asset};
+        if (xQueueSend(http_server_asset_queue_handle, &job, 0) == pdTRUE)
+        {
+            return ESP_OK;
+        }
+        httpd_req_async_handler_complete(async_req);
+    }
+
+    return http_server_send_asset(req, asset);
+}
 
-    httpd_resp_set_type(req, "image/x-icon");
-    httpd_resp_send(req, (const char *)favicon_ico_start, favicon_ico_end - favicon_ico_start);
+/**
+ * @brief Slot of the OTA writer being filled by the upload
+ */
+typedef struct
+{
+    char *data;
+    size_t len; /* Firmware bytes in the slot */
+} http_server_ota_slot_t;
 
+/**
+ * @brief Appends body bytes of the uploaded firmware to the slot, called by the multipart parser
+ *
+ * @note The chunk is received right behind the slot content and the bytes held back by the parser, so body bytes
+ *       are already in place. Only the bytes behind the part headers are moved.
+ *
+ * @param ctx slot
+ * @param data firmware bytes
+ * @param len number of bytes
+ * @return ESP_OK
+ */
+static esp_err_t http_server_OTA_write(void *ctx, const char *data, size_t len)
+{
+    http_server_ota_slot_t *slot = ctx;
+    if (data != slot->data + slot->len)
+    {
+        memmove(slot->data + slot->len, data, len);
+    }
+    slot->len += len;
     return ESP_OK;
 }
 
+/**
+ * @brief Replies the state of the uploaded image: bytes in the flash, the offset an upload continues at
+ *
+ * @param req HTTP request
+ * @param status HTTP status line
+ * @param offset image bytes in the flash
+ * @param size image size, 0 if unknown
+ * @return ESP_OK, otherwise ESP_FAIL if the reply could not be sent
+ */
+static esp_err_t http_server_OTA_send_offset(httpd_req_t *req, const char *status, uint32_t offset, uint32_t size)
+{
+    http_json_writer_t w;
+
+    httpd_resp_set_status(req, status);
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_member_uint(&w, "offset", offset);
+    http_json_member_uint(&w, "size", size);
+    http_json_member_bool(&w, "done", size != 0 && offset == size);
+    http_json_object_end(&w);
+    return http_json_finish(&w);
+}
+
 /**
  * @brief Receives the /bin file via the web page and handles the firmware update./
  *
+ * @note The httpd task receives into OTA writer slots of one flash sector while the writer task writes the
+ *       previous ones, so the network and the flash are busy at the same time.
+ *
+ *       The web page uploads a multipart/form-data form. An application/octet-stream body is the raw image, or the
+ *       range of it in Content-Range, with its SHA-256 in X-Image-Sha256. An interrupted raw upload continues at
+ *       the offset /OTAresume replies, and the SHA-256 is checked before the image is booted.
+ *
  * @param req HTTP request for which uri is need to be handled.
  * @return ESP_OK, otherwise ESP_FAIL if timeout occurs and update can not be started
  */
 static esp_err_t http_server_OTA_update_handler(httpd_req_t *req)
 {
-    esp_ota_handle_t ota_handle;
+    multipart_parser_t parser;
+    http_server_ota_slot_t slot = {.data = NULL, .len = 0};
+    uint8_t sha256[OTA_WRITER_SHA256_LEN];
 
-    uint32_t buffer_size = 1024;
-    char ota_buff[buffer_size];
+    char *content_type = http_arena_alloc(req, HTTP_SERVER_CONTENT_TYPE_SIZE);
     uint32_t content_length = req->content_len;
     int32_t receive_len;
     uint32_t content_received = 0;
-    bool is_request_body_started = false;
+    esp_err_t err = ESP_OK;
 
-    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
-    if (update_partition == NULL)
+    if (content_type == NULL)
     {
-        ESP_LOGI(TAG, "http_server_OTA_update_handler: INVALID PTA PARTITION");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of request memory");
         return ESP_FAIL;
     }
+    if (http_header_get_str(req, "Content-Type", content_type, HTTP_SERVER_CONTENT_TYPE_SIZE) != ESP_OK)
+    {
+        content_type[0] = '\0';
+    }
 
-    do
+    /* A raw body is the image from offset, the whole one without Content-Range */
+    bool raw = strncasecmp(content_type, "application/octet-stream", 24) == 0;
+    uint32_t offset = 0;
+    uint32_t last = content_length - 1;
+    uint32_t image_size = raw ? content_length : 0;
+    if (raw)
     {
+        if (content_length == 0 || http_header_get_hex(req, "X-Image-Sha256", sha256, sizeof(sha256)) != ESP_OK ||
+            !http_header_get_content_range(req, &offset, &last, &image_size) || last - offset + 1 != content_length)
+        {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected X-Image-Sha256 and Content-Range of the body");
+            return ESP_FAIL;
+        }
+    }
+    else if (multipart_parser_init(&parser, content_type, http_server_OTA_write, &slot) != ESP_OK)
+    {
+        ESP_LOGI(TAG, "http_server_OTA_update_handler: not a multipart/form-data upload");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected multipart/form-data");
+        return ESP_FAIL;
+    }
+
+    printf("http_server_OTA_update_handler: OTA file_size: %ld, image bytes %lu-%lu of %lu\n", content_length,
+           offset, last, image_size);
+    err = ota_writer_begin(raw ? sha256 : NULL, image_size, offset, content_length);
+    if (err != ESP_OK)
+    {
+        ESP_LOGI(TAG, "http_server_OTA_update_handler: OTA begin failed: %s", esp_err_to_name(err));
+        if (err == ESP_ERR_INVALID_ARG)
+        {
+            /* Not where the upload of this image stopped, the reply tells the client where to continue */
+            http_server_OTA_send_offset(req, "416 Range Not Satisfiable",
+                                        ota_writer_get_resume_offset(sha256, image_size), image_size);
+        }
+        else if (err == ESP_ERR_INVALID_SIZE)
+        {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Image does not fit the update partition");
+        }
+        else if (err == ESP_ERR_OTA_PARTITION_CONFLICT || err == ESP_ERR_OTA_ROLLBACK_INVALID_STATE)
+        {
+            app_state_set_fw_update_status(OTA_UPDATE_FAILED);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                                err == ESP_ERR_OTA_PARTITION_CONFLICT ? "Update partition is the running one"
+                                                                      : "Running firmware is not confirmed yet");
+        }
+        else
+        {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware update already running");
+        }
+        return ESP_FAIL;
+    }
+
+    int64_t last_push_us = esp_timer_get_time();
+    slot.data = ota_writer_acquire();
+    while (content_received < content_length && slot.data != NULL)
+    {
+        /* Bytes held back by the parser are written in front of the next chunk once they turn out to be firmware */
+        size_t held = raw ? 0 : multipart_parser_get_held(&parser);
+        if (OTA_WRITER_SLOT_SIZE - slot.len - held < HTTP_SERVER_OTA_MIN_RECEIVE)
+        {
+            err = ota_writer_submit(slot.data, slot.len);
+            slot.data = err == ESP_OK ? ota_writer_acquire() : NULL;
+            slot.len = 0;
+            continue;
+        }
+
         /* Read the data for the request */
-        receive_len = httpd_req_recv(req, ota_buff, MIN(content_length, buffer_size));
+        char *buffer = slot.data + slot.len + held;
+        int64_t receive_start_us = esp_timer_get_time();
+        receive_len = httpd_req_recv(req, buffer,
+                                     MIN(content_length - content_received, OTA_WRITER_SLOT_SIZE - slot.len - held));
+        int64_t now_us = esp_timer_get_time();
         if (receive_len < 0)
         {
             /* Check if timeout ocurred */
@@ -253,106 +584,168 @@ static esp_err_t http_server_OTA_update_handler(httpd_req_t *req)
                 continue; /* >Retry receiving if timeout occurred */
             }
             ESP_LOGI(TAG, "http_server_OTA_update_handler: OTA other error");
-            return ESP_FAIL;
+            break;
         }
-
-        /* If it is first data we are receiving.
-         * If so, it will have information in the header that we need.
-         */
-        if (!is_request_body_started)
+        if (receive_len == 0)
         {
-            is_request_body_started = true;
-
-            char *body_start_p = strstr(ota_buff, "\r\n\r\n") + 4;
-            uint32_t body_part_len = receive_len - (body_start_p - ota_buff);
-
-            printf("http_server_OTA_update_handler: OTA file_size: %ld\n", content_length);
-            esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-
-            if (err != ESP_OK)
-            {
-                printf("http_server_OTA_update_handler: Error with OTA begin, canceling the OTA");
-                return ESP_FAIL;
-            }
-            else
-            {
-                printf("http_server_OTA_update_handler: Writing to partition subtype %d at offset 0x%lx\r\n",
-                       update_partition->subtype, update_partition->address);
-            }
+            break;
+        }
+        content_received += receive_len;
+        ota_writer_add_received(receive_len, now_us - receive_start_us);
 
-            /* Write the first part of the data */
-            esp_ota_write(ota_handle, body_start_p, body_part_len);
-            content_received += body_part_len;
+        /* The httpd task is busy with the upload until it ends, so progress is pushed from here */
+        if (now_us - last_push_us >= HTTP_SERVER_OTA_PUSH_PERIOD_MS * 1000)
+        {
+            last_push_us = now_us;
+            http_server_ws_broadcast_work((void *)(uintptr_t)HTTP_WS_TOPIC_OTA);
         }
-        else
+
+        err = raw ? http_server_OTA_write(&slot, buffer, receive_len)
+                  : multipart_parser_feed(&parser, buffer, receive_len);
+        if (err != ESP_OK)
         {
-            /* Write OTA data */
-            esp_ota_write(ota_handle, ota_buff, receive_len);
-            content_received += receive_len;
+            ESP_LOGI(TAG, "http_server_OTA_update_handler: %s at byte %lu", esp_err_to_name(err),
+                     content_received);
+            ota_writer_finish();
+            app_state_set_fw_update_status(OTA_UPDATE_FAILED);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware upload failed");
+            return ESP_OK;
         }
-    } while (receive_len > 0 && content_received < content_length);
+    }
+    /* Everything received is written, a raw upload which broke off continues from there */
+    if (slot.data != NULL)
+    {
+        ota_writer_submit(slot.data, slot.len);
+    }
+    /* Flash write errors surface here, also when they stopped the loop above */
+    err = ota_writer_finish();
 
-    if (esp_ota_end(ota_handle) != ESP_OK)
+    if (err != ESP_OK || content_received < content_length || (!raw && !multipart_parser_is_done(&parser)))
     {
-        ESP_LOGI(TAG, "http_server_OTA_update_handler: esp_ota_end ERROR");
-        http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_FAILED);
-        return ESP_OK;
+        ESP_LOGI(TAG, "http_server_OTA_update_handler: %s at byte %lu, image bytes in flash %lu",
+                 err != ESP_OK ? esp_err_to_name(err) : "upload truncated", content_received,
+                 ota_writer_get_written());
+        /* A raw upload which broke off is not lost, only a flash error or a broken form fails the update */
+        app_state_set_fw_update_status(raw && err == ESP_OK ? OTA_UPDATE_PARTIAL : OTA_UPDATE_FAILED);
+        return ESP_FAIL;
+    }
+    if (raw && ota_writer_get_written() < image_size)
+    {
+        /* Range uploaded, the rest follows in the next request */
+        app_state_set_fw_update_status(OTA_UPDATE_PARTIAL);
+        return http_server_OTA_send_offset(req, "200 OK", ota_writer_get_written(), image_size);
     }
 
-    if (esp_ota_set_boot_partition(update_partition) != ESP_OK)
+    err = ota_writer_commit();
+    if (err != ESP_OK)
     {
-        ESP_LOGI(TAG, "http_server_OTA_update_handler: Flash ERROR");
-        http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_FAILED);
+        ESP_LOGI(TAG, "http_server_OTA_update_handler: image rejected: %s", esp_err_to_name(err));
+        app_state_set_fw_update_status(OTA_UPDATE_FAILED);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            err == ESP_ERR_INVALID_CRC ? "Image SHA-256 mismatch" : "Invalid image");
         return ESP_OK;
     }
 
     const esp_partition_t *boot_partition = esp_ota_get_boot_partition();
     ESP_LOGI(TAG, "http_server_OTA_update_handler: Next boot partition subtype %d at offset 0x%lx",
              boot_partition->subtype, boot_partition->address);
-    http_server_monitor_send_message(HTTP_MSG_OTA_UPDATE_SUCCESSFUL);
-    return ESP_OK;
+    app_state_set_fw_update_status(OTA_UPDATE_SUCCESS);
+    return http_server_OTA_send_offset(req, "200 OK", ota_writer_get_written(), ota_writer_get_written());
 }
 
 /**
- * @brief OTA status handler responds with the firmware update status after the OTA update is started \
- * and responds with the compile time/date when the page is first requested.
+ * @brief Replies where an interrupted raw upload of the image in the X-Image-Sha256 and X-Image-Size headers
+ * continues, 0 if it has to start from the beginning.
  *
  * @param req HTTP request for which uri is need to be handled.
  * @return ESP_OK
  */
-static esp_err_t http_server_OTA_status_handler(httpd_req_t *req)
+static esp_err_t http_server_OTA_resume_handler(httpd_req_t *req)
 {
-    char otaJSON[128];
-
-    ESP_LOGI(TAG, "OTAstatus requested");
-    sprintf(otaJSON, "{\"ota_update_status\":%d,\"compile_time\":\"%s\",\"compile_date\":\"%s\"}", g_fw_update_status,
-            __TIME__, __DATE__);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, otaJSON, strlen(otaJSON));
+    uint8_t sha256[OTA_WRITER_SHA256_LEN];
+    uint32_t image_size = 0;
 
-    return ESP_OK;
+    if (http_header_get_hex(req, "X-Image-Sha256", sha256, sizeof(sha256)) != ESP_OK ||
+        !http_header_get_uint(req, "X-Image-Size", &image_size) || image_size == 0)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected X-Image-Sha256 and X-Image-Size");
+        return ESP_OK;
+    }
+    return http_server_OTA_send_offset(req, "200 OK", ota_writer_get_resume_offset(sha256, image_size), image_size);
 }
 
 /**
- * @brief Get the value from HTTP request header.
+ * @brief Starts a pull OTA update from the manifest URL in the body, the saved URL if the body is empty.
+ *
+ * @note The pull runs in its own task, its state is reported by /OTAstatus and /ws.
  *
  * @param req HTTP request for which uri is need to be handled.
- * @param field header field that should be found and returned.
- * @return allocated char* if information was found, otherwise NULL;
+ * @return ESP_OK
  */
-static char *get_value_from_header(httpd_req_t *req, char *field)
+static esp_err_t http_server_OTA_pull_handler(httpd_req_t *req)
 {
-    size_t len = httpd_req_get_hdr_value_len(req, field) + 1;
-    char *str = NULL;
-    if (len > 1)
+    char *url = http_arena_alloc(req, OTA_PULL_URL_SIZE);
+    size_t len = 0;
+
+    if (url == NULL || req->content_len >= OTA_PULL_URL_SIZE)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Manifest URL too long");
+        return ESP_OK;
+    }
+    while (len < req->content_len)
     {
-        str = malloc(len);
-        if (httpd_req_get_hdr_value_str(req, field, str, len) == ESP_OK)
+        int receive_len = httpd_req_recv(req, url + len, req->content_len - len);
+        if (receive_len <= 0)
         {
-            ESP_LOGI(TAG, "get_value_from_header: Found header -> %s: %s", field, str);
+            return ESP_FAIL;
         }
+        len += receive_len;
+    }
+    url[len] = '\0';
+
+    esp_err_t err = ota_pull_start(len > 0 ? url : NULL);
+    ESP_LOGI(TAG, "OTApull requested: %s", esp_err_to_name(err));
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No manifest URL saved");
+        return ESP_OK;
     }
-    return str;
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Pull could not be started");
+        return ESP_OK;
+    }
+
+    /* A running pull is not an error, the client follows it like a new one */
+    http_json_writer_t w;
+    httpd_resp_set_status(req, err == ESP_OK ? "202 Accepted" : "409 Conflict");
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_member_string(&w, "pull", ota_pull_get_state_name(ota_pull_get_state()));
+    http_json_object_end(&w);
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief OTA status handler responds with the firmware update status after the OTA update is started \
+ * and responds with the compile time/date when the page is first requested.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_OTA_status_handler(httpd_req_t *req)
+{
+    http_json_writer_t w;
+    app_state_t state;
+
+    ESP_LOGI(TAG, "OTAstatus requested");
+    app_state_get(&state);
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_server_write_ota_status(&w, &state);
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
 }
 
 /**
@@ -365,17 +758,21 @@ static esp_err_t http_server_wifi_connect_json_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, "wifiConnect.json requested");
 
-    char *ssid_str = get_value_from_header(req, "my-connect-ssid");
-    char *pwd_str = get_value_from_header(req, "my-connect-pwd");
+    /* SSID and password fill the whole fields of wifi_sta_config_t at most, they are not null-terminated then */
+    wifi_config_t *wifi_config = wifi_app_get_wifi_config();
+    char ssid[sizeof(wifi_config->sta.ssid) + 1];
+    char pwd[sizeof(wifi_config->sta.password) + 1];
+    if (http_header_get_str(req, "my-connect-ssid", ssid, sizeof(ssid)) != ESP_OK ||
+        http_header_get_str(req, "my-connect-pwd", pwd, sizeof(pwd)) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid SSID or password");
+        return ESP_OK;
+    }
 
     /* Update the WiFi network configuration and let the wifi app know */
-    wifi_config_t *wifi_config = wifi_app_get_wifi_config();
     memset(wifi_config, 0x00, sizeof(wifi_config_t));
-    memcpy(wifi_config->sta.ssid, ssid_str, strlen(ssid_str) + 1);
-    memcpy(wifi_config->sta.password, pwd_str, strlen(pwd_str) + 1);
-
-    free(ssid_str);
-    free(pwd_str);
+    memcpy(wifi_config->sta.ssid, ssid, strlen(ssid));
+    memcpy(wifi_config->sta.password, pwd, strlen(pwd));
 
     wifi_app_send_message(WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER);
     return ESP_OK;
@@ -403,14 +800,17 @@ static esp_err_t http_server_wifi_disconnect_json_handler(httpd_req_t *req)
  */
 static esp_err_t http_server_wifi_connect_status_json_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "/wifiConnectStatus requested");
-    char statusJSON[30];
-    sprintf(statusJSON, "{\"wifi_connect_status\":%d}", g_wifi_connect_status);
+    http_json_writer_t w;
+    app_state_t state;
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, statusJSON, strlen(statusJSON));
+    ESP_LOGI(TAG, "/wifiConnectStatus requested");
+    app_state_get(&state);
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_server_write_wifi_status(&w, &state);
+    http_json_object_end(&w);
 
-    return ESP_OK;
+    return http_json_finish(&w);
 }
 
 /**
@@ -423,18 +823,19 @@ static esp_err_t http_server_get_wifi_connect_info_json_handler(httpd_req_t *req
 {
     ESP_LOGI(TAG, "/wifiConnectInfo.json requested");
 
-    char ipInfoJSON[200];
-    memset(ipInfoJSON, 0, sizeof(ipInfoJSON));
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
 
     char ip[IP4ADDR_STRLEN_MAX];
     char netmask[IP4ADDR_STRLEN_MAX];
     char gw[IP4ADDR_STRLEN_MAX];
+    app_state_t state;
 
-    if (g_wifi_connect_status == HTTP_WIFI_STATUS_CONNECT_SUCCESS)
+    app_state_get(&state);
+    if (state.wifi_connect_status == APP_WIFI_STATUS_CONNECT_SUCCESS)
     {
         wifi_ap_record_t wifi_data;
         ESP_ERROR_CHECK(esp_wifi_sta_get_ap_info(&wifi_data));
-        char *ssid = (char *)wifi_data.ssid;
 
         esp_netif_ip_info_t ip_info;
         ESP_ERROR_CHECK(esp_netif_get_ip_info(esp_netif_sta, &ip_info));
@@ -442,31 +843,377 @@ static esp_err_t http_server_get_wifi_connect_info_json_handler(httpd_req_t *req
         esp_ip4addr_ntoa(&ip_info.netmask, netmask, IP4ADDR_STRLEN_MAX);
         esp_ip4addr_ntoa(&ip_info.gw, gw, IP4ADDR_STRLEN_MAX);
 
-        sprintf(ipInfoJSON, "{\"ip\":\"%s\",\"netmask\":\"%s\",\"gw\":\"%s\",\"ap\":\"%s\"}", ip, netmask, gw, ssid);
+        http_json_object_begin(&w);
+        http_json_member_string(&w, "ip", ip);
+        http_json_member_string(&w, "netmask", netmask);
+        http_json_member_string(&w, "gw", gw);
+        http_json_member_string(&w, "ap", (const char *)wifi_data.ssid);
+        http_json_object_end(&w);
     }
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, ipInfoJSON, strlen(ipInfoJSON));
+    return http_json_finish(&w);
+}
 
-    return ESP_OK;
+/**
+ * @brief Writes configuration of one strip channel as JSON object.
+ *
+ * @param w JSON writer.
+ * @param channel channel index.
+ * @param config channel configuration.
+ */
+static void http_server_write_strip_config(http_json_writer_t *w, uint8_t channel, const ws2812_strip_config_t *config)
+{
+    http_json_object_begin(w);
+    http_json_member_uint(w, "channel", channel);
+    http_json_member_uint(w, "led_count", config->led_count);
+    http_json_member_uint(w, "gpio", config->gpio);
+    http_json_member_uint(w, "color_order", config->color_order);
+    http_json_member_uint(w, "resolution_hz", config->resolution_hz);
+    http_json_member_uint(w, "use_dma", config->use_dma);
+    http_json_object_end(w);
+}
+
+/**
+ * @brief stripConfig.json GET handler responds with the led strip configuration the lamp is running with.
+ *
+ * @note Only the channel from strip-channel header is returned if it is present, otherwise all channels.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_get_strip_config_json_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "/stripConfig.json requested");
+
+    ws2812_strip_config_t config;
+    uint32_t channel = WS2812_CHANNEL_ALL;
+    if (!http_header_get_uint(req, "strip-channel", &channel) ||
+        (channel != WS2812_CHANNEL_ALL && (channel > UINT8_MAX || ws2812_get_strip_config(channel, &config) != ESP_OK)))
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown strip channel");
+        return ESP_OK;
+    }
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    if (channel != WS2812_CHANNEL_ALL)
+    {
+        http_server_write_strip_config(&w, channel, &config);
+    }
+    else
+    {
+        uint8_t channel_count = ws2812_get_channel_count();
+        http_json_object_begin(&w);
+        http_json_member_uint(&w, "channel_count", channel_count);
+        http_json_key(&w, "channels");
+        http_json_array_begin(&w);
+        for (uint8_t i = 0; i < channel_count; i++)
+        {
+            ws2812_get_strip_config(i, &config);
+            http_server_write_strip_config(&w, i, &config);
+        }
+        http_json_array_end(&w);
+        http_json_object_end(&w);
+    }
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief stripConfig.json POST handler saves the led strip configuration to NVS, it is applied after restart.
+ *
+ * @note Fields are passed in strip-led-count, strip-gpio, strip-color-order (ws2812_color_order_e),
+ *       strip-resolution-hz and strip-use-dma headers, missing headers keep the current value.
+ *       strip-channel header selects the channel, 0 by default. A new channel can be added right after
+ *       the last running one, strip-led-count 0 disables a channel above 0 together with the following ones.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_set_strip_config_json_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "/stripConfig.json update requested");
+
+    uint32_t channel = 0;
+    if (!http_header_get_uint(req, "strip-channel", &channel) || channel > ws2812_get_channel_count() ||
+        channel >= WS2812_MAX_CHANNELS)
+    {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown strip channel");
+        return ESP_OK;
+    }
+
+    /* New channel starts from the defaults */
+    ws2812_strip_config_t config;
+    if (ws2812_get_strip_config(channel, &config) != ESP_OK)
+    {
+        ws2812_default_strip_config(&config);
+    }
+
+    uint32_t led_count = config.led_count;
+    uint32_t gpio = config.gpio;
+    uint32_t color_order = config.color_order;
+    uint32_t resolution_hz = config.resolution_hz;
+    uint32_t use_dma = config.use_dma;
+
+    bool valid = http_header_get_uint(req, "strip-led-count", &led_count) &&
+                 http_header_get_uint(req, "strip-gpio", &gpio) &&
+                 http_header_get_uint(req, "strip-color-order", &color_order) &&
+                 http_header_get_uint(req, "strip-resolution-hz", &resolution_hz) &&
+                 http_header_get_uint(req, "strip-use-dma", &use_dma);
+    valid = valid && led_count <= UINT16_MAX && gpio <= UINT8_MAX && color_order <= UINT8_MAX;
+    if (valid)
+    {
+        config.led_count = (uint16_t)led_count;
+        config.gpio = (uint8_t)gpio;
+        config.color_order = (uint8_t)color_order;
+        config.resolution_hz = resolution_hz;
+        config.use_dma = use_dma != 0;
+        valid = ws2812_validate_strip_config(&config) == ESP_OK || (channel > 0 && config.led_count == 0);
+    }
+
+    if (!valid)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid strip configuration");
+        return ESP_OK;
+    }
+
+    if (app_nvs_save_strip_config(channel, &config) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Unable to save strip configuration");
+        return ESP_OK;
+    }
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_member_bool(&w, "saved", true);
+    http_json_member_bool(&w, "restart_required", true);
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief effects.json GET handler responds with the effects of the registry.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_get_effects_json_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "/effects.json requested");
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_key(&w, "effects");
+    http_json_array_begin(&w);
+    for (uint32_t e = 0; e < WS2812_EFFECT_COUNT; ++e)
+    {
+        const ws2812_effect_info_t *info = ws2812_effect_get((ws2812_effect_e)e);
+        if (info == NULL)
+        {
+            continue;
+        }
+        http_json_object_begin(&w);
+        http_json_member_uint(&w, "id", e);
+        http_json_member_string(&w, "name", info->name);
+        http_json_member_bool(&w, "animated", info->animated);
+        http_json_object_end(&w);
+    }
+    http_json_array_end(&w);
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief effect.json POST handler starts the effect selected by id, id 0 stops the running effect.
+ *
+ * @note Effect is selected by effect-id header, effect-channel selects the strip channel (all by default).
+ *       Optional effect-period-ms, effect-length, effect-primary and effect-secondary (hex RRGGBB) headers
+ *       override the defaults of the effect.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_set_effect_json_handler(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "/effect.json requested");
+
+    uint32_t id = WS2812_EFFECT_COUNT;
+    uint32_t channel = WS2812_CHANNEL_ALL;
+    bool valid =
+        http_header_get_uint(req, "effect-id", &id) && http_header_get_uint(req, "effect-channel", &channel);
+    const ws2812_effect_info_t *info = ws2812_effect_get((ws2812_effect_e)id);
+    valid = valid && (id == WS2812_EFFECT_NONE || info != NULL) &&
+            (channel == WS2812_CHANNEL_ALL || channel < ws2812_get_channel_count());
+
+    ws2812_effect_params_t params = {0};
+    if (valid && info != NULL)
+    {
+        uint32_t period_ms = info->default_params.period_ms;
+        uint32_t length = info->default_params.length;
+        params = info->default_params;
+        valid = http_header_get_uint(req, "effect-period-ms", &period_ms) &&
+                http_header_get_uint(req, "effect-length", &length) &&
+                http_header_get_color(req, "effect-primary", &params.primary) &&
+                http_header_get_color(req, "effect-secondary", &params.secondary) && length <= UINT16_MAX;
+        params.period_ms = period_ms;
+        params.length = (uint16_t)length;
+    }
+
+    if (!valid)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid effect");
+        return ESP_OK;
+    }
+
+    ws2812_start_effect((uint8_t)channel, (ws2812_effect_e)id, &params);
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_member_uint(&w, "id", id);
+    http_json_member_string(&w, "name", info != NULL ? info->name : "none");
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief serverStats.json GET handler responds with request arena usage and the stack headroom of the httpd task.
+ *
+ * @note Used to size HTTP_ARENA_SIZE and HTTP_SERVER_TASK_SIZE, the values are the worst case since boot.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_get_server_stats_json_handler(httpd_req_t *req)
+{
+    http_arena_stats_t arena;
+    http_arena_get_stats(&arena);
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_key(&w, "arena");
+    http_json_object_begin(&w);
+    http_json_member_uint(&w, "size", arena.size);
+    http_json_member_uint(&w, "high_water", arena.high_water);
+    http_json_member_uint(&w, "in_use", arena.in_use);
+    http_json_member_uint(&w, "in_use_max", arena.in_use_max);
+    http_json_member_uint(&w, "alloc_failures", arena.alloc_failures);
+    http_json_object_end(&w);
+    /* Handlers run in the httpd task, so this is its stack */
+    http_json_member_uint(&w, "httpd_stack_size", HTTP_SERVER_TASK_SIZE);
+    http_json_member_uint(&w, "httpd_stack_free_min", uxTaskGetStackHighWaterMark(NULL));
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief bootProfile.json GET handler responds with the begin and the end of every boot phase.
+ *
+ * @note Times are microseconds since boot, end_us is missing while a phase runs or if it did not run, e.g. the
+ *       station connect without saved credentials.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK
+ */
+static esp_err_t http_server_get_boot_profile_json_handler(httpd_req_t *req)
+{
+    boot_profile_phase_t phases[BOOT_PHASE_COUNT];
+    boot_profile_get(phases);
+
+    http_json_writer_t w;
+    http_json_init(&w, req, http_arena_alloc(req, HTTP_JSON_BUFFER_SIZE), HTTP_JSON_BUFFER_SIZE);
+    http_json_object_begin(&w);
+    http_json_key(&w, "phases");
+    http_json_array_begin(&w);
+    for (uint32_t i = 0; i < BOOT_PHASE_COUNT; ++i)
+    {
+        if (i != BOOT_PHASE_STARTUP && phases[i].begin_us == 0)
+        {
+            continue;
+        }
+        http_json_object_begin(&w);
+        http_json_member_string(&w, "name", boot_profile_get_phase_name(i));
+        http_json_member_uint(&w, "begin_us", (uint32_t)phases[i].begin_us);
+        if (phases[i].end_us != 0)
+        {
+            http_json_member_uint(&w, "end_us", (uint32_t)phases[i].end_us);
+        }
+        http_json_object_end(&w);
+    }
+    http_json_array_end(&w);
+    http_json_object_end(&w);
+
+    return http_json_finish(&w);
+}
+
+/**
+ * @brief /ws handler, clients subscribe to Wi-Fi, OTA and lamp state pushed by the monitor task.
+ *
+ * @note The whole state is sent right after the handshake. Clients are not expected to send anything,
+ *       received frames are dropped.
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK, ESP_FAIL to close the connection
+ */
+static esp_err_t http_server_ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET)
+    {
+        int fd = httpd_req_to_sockfd(req);
+        ESP_LOGI(TAG, "/ws client connected on socket %d", fd);
+        httpd_queue_work(req->handle, http_server_ws_snapshot_work, (void *)(intptr_t)fd);
+        return ESP_OK;
+    }
+
+    uint8_t payload[HTTP_SERVER_WS_MAX_FRAME];
+    httpd_ws_frame_t frame = {.payload = payload};
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK || frame.len > sizeof(payload))
+    {
+        return ESP_FAIL;
+    }
+    return frame.len > 0 ? httpd_ws_recv_frame(req, &frame, sizeof(payload)) : ESP_OK;
+}
+
+/**
+ * @brief Calls the handler of the uri and releases the request scratch memory once it returns
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return result of the handler
+ */
+static esp_err_t http_server_dispatch(httpd_req_t *req)
+{
+    esp_err_t (*handler)(httpd_req_t *r) = (esp_err_t(*)(httpd_req_t *))req->user_ctx;
+    esp_err_t err = handler(req);
+    http_arena_reset(req);
+    return err;
 }
 
 /**
  * @brief Creates and registers uri handler on HTTP server
  *
+ * @note Handlers are called through http_server_dispatch(), so they can allocate scratch memory with
+ *       http_arena_alloc().
+ *
  * @param uri uri that should be registered.
  * @param method HTTP method.
  * @param handler uri handler.
- * @param user_ctx user information.
  */
 static void http_server_create_and_register_uri_handle(const char *uri, enum http_method method,
-                                                       esp_err_t (*handler)(httpd_req_t *r), void *user_ctx)
+                                                       esp_err_t (*handler)(httpd_req_t *r))
 {
     httpd_uri_t _httpd_uri = {
         .uri = uri,
         .method = method,
-        .handler = handler,
-        .user_ctx = user_ctx,
+        .handler = http_server_dispatch,
+        .user_ctx = (void *)handler,
     };
     httpd_register_uri_handler(http_server_handle, &_httpd_uri);
 }
@@ -481,22 +1228,31 @@ static httpd_handle_t http_server_configure()
     /* Generate default configuration */
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
 
-    /* Create http sever monitor task */
-    xTaskCreatePinnedToCore(&http_server_monitor, "http_server_monitor", HTTP_SERVER_MONITOR_SIZE, NULL,
-                            HTTP_SERVER_MONITOR_PRIORITY, &task_server_http_monitor, HTTP_SERVER_MONITOR_CORE_ID);
-    /* Create message queue */
-    http_server_monitor_queue_handle = xQueueCreate(3, sizeof(http_server_queue_message_t));
+    /* Create asset workers once, they outlive server restarts */
+    if (http_server_asset_queue_handle == NULL)
+    {
+        http_server_asset_queue_handle = xQueueCreate(HTTP_SERVER_ASSET_WORKERS, sizeof(http_server_asset_job_t));
+        for (uint32_t i = 0; i < HTTP_SERVER_ASSET_WORKERS; ++i)
+        {
+            xTaskCreatePinnedToCore(&http_server_asset_worker, "http_asset_worker", HTTP_SERVER_ASSET_WORKER_SIZE,
+                                    NULL, HTTP_SERVER_ASSET_WORKER_PRIORITY, NULL, HTTP_SERVER_ASSET_WORKER_CORE_ID);
+        }
+    }
     /* The core that the HTTP server will run on */
     config.core_id = HTTP_SERVER_TASK_CODE_ID;
     config.task_priority = HTTP_SERVER_TASK_PRIORITY;
     config.stack_size = HTTP_SERVER_TASK_SIZE;
     config.max_uri_handlers = 20;
+    config.max_open_sockets = HTTP_SERVER_MAX_OPEN_SOCKETS;
+    config.lru_purge_enable = true;
 
     uint16_t receive_wait_timeout_s = 10;
     uint16_t send_wait_timeout_s = 10;
 
     config.recv_wait_timeout = receive_wait_timeout_s;
     config.send_wait_timeout = send_wait_timeout_s;
+    /* Static assets are served by one wildcard handler registered last, exact uris still match exactly */
+    config.uri_match_fn = httpd_uri_match_wildcard;
 
     ESP_LOGI(TAG, "http_server_configure: starting server on port: %d, with task priority: %d", config.server_port,
              config.task_priority);
@@ -509,21 +1265,38 @@ static httpd_handle_t http_server_configure()
     ESP_LOGI(TAG, "http_server_configure: Registering URI handlers");
 
     /* Register URI handlers */
-    http_server_create_and_register_uri_handle("/jquery-3.6.1.min.js", HTTP_GET, http_server_jquery_handler, NULL);
-    http_server_create_and_register_uri_handle("/", HTTP_GET, http_server_index_html_handler, NULL);
-    http_server_create_and_register_uri_handle("/app.css", HTTP_GET, http_server_app_css_handler, NULL);
-    http_server_create_and_register_uri_handle("/app.js", HTTP_GET, http_server_app_js_handler, NULL);
-    http_server_create_and_register_uri_handle("/favicon.ico", HTTP_GET, http_server_favicon_ico_handler, NULL);
-    http_server_create_and_register_uri_handle("/OTAupdate", HTTP_POST, http_server_OTA_update_handler, NULL);
-    http_server_create_and_register_uri_handle("/OTAstatus", HTTP_POST, http_server_OTA_status_handler, NULL);
-    http_server_create_and_register_uri_handle("/wifiConnect.json", HTTP_POST, http_server_wifi_connect_json_handler,
-                                               NULL);
+    http_server_create_and_register_uri_handle("/OTAresume", HTTP_GET, http_server_OTA_resume_handler);
+    http_server_create_and_register_uri_handle("/OTAupdate", HTTP_POST, http_server_OTA_update_handler);
+    http_server_create_and_register_uri_handle("/OTAstatus", HTTP_POST, http_server_OTA_status_handler);
+    http_server_create_and_register_uri_handle("/OTApull", HTTP_POST, http_server_OTA_pull_handler);
+    http_server_create_and_register_uri_handle("/wifiConnect.json", HTTP_POST, http_server_wifi_connect_json_handler);
     http_server_create_and_register_uri_handle("/wifiDisconnect.json", HTTP_DELETE,
-                                               http_server_wifi_disconnect_json_handler, NULL);
+                                               http_server_wifi_disconnect_json_handler);
     http_server_create_and_register_uri_handle("/wifiConnectStatus", HTTP_POST,
-                                               http_server_wifi_connect_status_json_handler, NULL);
+                                               http_server_wifi_connect_status_json_handler);
     http_server_create_and_register_uri_handle("/wifiConnectInfo.json", HTTP_GET,
-                                               http_server_get_wifi_connect_info_json_handler, NULL);
+                                               http_server_get_wifi_connect_info_json_handler);
+    http_server_create_and_register_uri_handle("/stripConfig.json", HTTP_GET,
+                                               http_server_get_strip_config_json_handler);
+    http_server_create_and_register_uri_handle("/stripConfig.json", HTTP_POST,
+                                               http_server_set_strip_config_json_handler);
+    http_server_create_and_register_uri_handle("/effects.json", HTTP_GET, http_server_get_effects_json_handler);
+    http_server_create_and_register_uri_handle("/effect.json", HTTP_POST, http_server_set_effect_json_handler);
+    http_server_create_and_register_uri_handle("/serverStats.json", HTTP_GET,
+                                               http_server_get_server_stats_json_handler);
+    http_server_create_and_register_uri_handle("/bootProfile.json", HTTP_GET,
+                                               http_server_get_boot_profile_json_handler);
+    httpd_uri_t ws_uri = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = http_server_ws_handler,
+        .is_websocket = true,
+    };
+    httpd_register_uri_handler(http_server_handle, &ws_uri);
+    lamp_api_register_handlers(http_server_handle);
+    http_server_create_and_register_uri_handle("/*", HTTP_GET, http_server_asset_handler);
+
+    app_state_subscribe(APP_STATE_TOPIC_ALL, http_server_state_subscriber, NULL);
     return http_server_handle;
 }
 
@@ -539,15 +1312,11 @@ void http_server_stop()
 {
     if (http_server_handle != NULL)
     {
+        app_state_unsubscribe(http_server_state_subscriber, NULL);
         httpd_stop(http_server_handle);
+        http_server_handle = NULL;
         ESP_LOGI(TAG, "http_server_stop: stopping HTTP server");
     }
-    if (task_server_http_monitor)
-    {
-        vTaskDelete(task_server_http_monitor);
-        ESP_LOGI(TAG, "http_server_stop: stopping HTTP server monitor");
-        task_server_http_monitor = NULL;
-    }
 }
 
 void http_server_fw_update_reset_callback(void *arg)
@@ -0,0 +1,491 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "http_util.h"
+
+/* Longest header value holding a number or a color */
+#define HTTP_HEADER_NUMBER_SIZE 16
+/* Longest header value holding hex data, a SHA-256 digest */
+#define HTTP_HEADER_HEX_SIZE 65
+/* Longest Content-Range value, bytes and three 32-bit numbers */
+#define HTTP_HEADER_RANGE_SIZE 48
+
+/**
+ * @brief Sends the buffered output as a chunk of the reply
+ */
+static void http_json_flush(http_json_writer_t *w)
+{
+    if (w->len > 0 && w->err == ESP_OK && httpd_resp_send_chunk(w->req, w->buffer, w->len) != ESP_OK)
+    {
+        w->err = ESP_FAIL;
+    }
+    w->chunked = true;
+    w->len = 0;
+}
+
+/**
+ * @brief Appends raw output, flushes the buffer to the request when it is full
+ */
+static void http_json_put(http_json_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0 && w->err == ESP_OK)
+    {
+        if (w->len == w->size)
+        {
+            if (w->req == NULL)
+            {
+                w->err = ESP_ERR_INVALID_SIZE;
+                return;
+            }
+            http_json_flush(w);
+        }
+        size_t part = w->size - w->len < len ? w->size - w->len : len;
+        memcpy(w->buffer + w->len, data, part);
+        w->len += part;
+        data += part;
+        len -= part;
+    }
+}
+
+/**
+ * @brief Writes the comma separating a value from the previous one
+ */
+static void http_json_separate(http_json_writer_t *w)
+{
+    if (w->need_comma)
+    {
+        http_json_put(w, ",", 1);
+    }
+    w->need_comma = true;
+}
+
+void http_json_init(http_json_writer_t *w, httpd_req_t *req, char *buffer, size_t size)
+{
+    memset(w, 0, sizeof(*w));
+    w->req = req;
+    w->buffer = buffer;
+    w->size = size;
+    if (buffer == NULL)
+    {
+        w->err = ESP_ERR_NO_MEM;
+    }
+    if (req != NULL)
+    {
+        httpd_resp_set_type(req, "application/json");
+    }
+}
+
+void http_json_object_begin(http_json_writer_t *w)
+{
+    http_json_separate(w);
+    http_json_put(w, "{", 1);
+    w->need_comma = false;
+}
+
+void http_json_object_end(http_json_writer_t *w)
+{
+    http_json_put(w, "}", 1);
+    w->need_comma = true;
+}
+
+void http_json_array_begin(http_json_writer_t *w)
+{
+    http_json_separate(w);
+    http_json_put(w, "[", 1);
+    w->need_comma = false;
+}
+
+void http_json_array_end(http_json_writer_t *w)
+{
+    http_json_put(w, "]", 1);
+    w->need_comma = true;
+}
+
+void http_json_key(http_json_writer_t *w, const char *key)
+{
+    http_json_separate(w);
+    http_json_put(w, "\"", 1);
+    http_json_put(w, key, strlen(key));
+    http_json_put(w, "\":", 2);
+    w->need_comma = false;
+}
+
+void http_json_string(http_json_writer_t *w, const char *value)
+{
+    http_json_separate(w);
+    http_json_put(w, "\"", 1);
+    const char *run = value;
+    for (const char *p = value; *p != '\0'; ++p)
+    {
+        unsigned char c = (unsigned char)*p;
+        if (c != '"' && c != '\\' && c >= 0x20)
+        {
+            continue;
+        }
+        http_json_put(w, run, p - run);
+        char escaped[7];
+        int len = c == '"' || c == '\\' ? snprintf(escaped, sizeof(escaped), "\\%c", c)
+                                        : snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        http_json_put(w, escaped, len);
+        run = p + 1;
+    }
+    http_json_put(w, run, strlen(run));
+    http_json_put(w, "\"", 1);
+}
+
+void http_json_int(http_json_writer_t *w, int32_t value)
+{
+    char number[12];
+    http_json_separate(w);
+    http_json_put(w, number, snprintf(number, sizeof(number), "%ld", (long)value));
+}
+
+void http_json_uint(http_json_writer_t *w, uint32_t value)
+{
+    char number[11];
+    http_json_separate(w);
+    http_json_put(w, number, snprintf(number, sizeof(number), "%lu", (unsigned long)value));
+}
+
+void http_json_bool(http_json_writer_t *w, bool value)
+{
+    http_json_separate(w);
+    http_json_put(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+void http_json_member_string(http_json_writer_t *w, const char *key, const char *value)
+{
+    http_json_key(w, key);
+    http_json_string(w, value);
+}
+
+void http_json_member_int(http_json_writer_t *w, const char *key, int32_t value)
+{
+    http_json_key(w, key);
+    http_json_int(w, value);
+}
+
+void http_json_member_uint(http_json_writer_t *w, const char *key, uint32_t value)
+{
+    http_json_key(w, key);
+    http_json_uint(w, value);
+}
+
+void http_json_member_bool(http_json_writer_t *w, const char *key, bool value)
+{
+    http_json_key(w, key);
+    http_json_bool(w, value);
+}
+
+esp_err_t http_json_finish(http_json_writer_t *w)
+{
+    if (w->req != NULL && w->err != ESP_OK && !w->chunked)
+    {
+        /* Nothing was sent yet, so the client still gets a complete reply */
+        httpd_resp_send_err(w->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of request memory");
+    }
+    if (w->req == NULL || w->err != ESP_OK)
+    {
+        return w->err;
+    }
+
+    if (!w->chunked)
+    {
+        /* Whole reply fits the buffer, send it with Content-Length */
+        return httpd_resp_send(w->req, w->buffer, w->len) == ESP_OK ? ESP_OK : ESP_FAIL;
+    }
+    http_json_flush(w);
+    if (w->err == ESP_OK && httpd_resp_send_chunk(w->req, NULL, 0) != ESP_OK)
+    {
+        w->err = ESP_FAIL;
+    }
+    return w->err;
+}
+
+esp_err_t http_header_get_str(httpd_req_t *req, const char *field, char *buffer, size_t size)
+{
+    size_t len = httpd_req_get_hdr_value_len(req, field);
+    if (len == 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (len >= size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return httpd_req_get_hdr_value_str(req, field, buffer, size) == ESP_OK ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Reads number in the given base from a request header
+ *
+ * @return true if the header is missing or holds a valid number not above max, otherwise false
+ */
+static bool http_header_get_number(httpd_req_t *req, const char *field, int base, uint32_t max, uint32_t *value)
+{
+    char str[HTTP_HEADER_NUMBER_SIZE];
+    esp_err_t err = http_header_get_str(req, field, str, sizeof(str));
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        return true;
+    }
+    if (err != ESP_OK || str[0] == '-')
+    {
+        return false;
+    }
+
+    /* unsigned long is 32 bits on the target, an overflow only shows as ERANGE */
+    char *end = NULL;
+    errno = 0;
+    unsigned long number = strtoul(str, &end, base);
+    if (end == str || *end != '\0' || errno == ERANGE || number > max)
+    {
+        return false;
+    }
+    *value = (uint32_t)number;
+    return true;
+}
+
+bool http_header_get_uint(httpd_req_t *req, const char *field, uint32_t *value)
+{
+    return http_header_get_number(req, field, 10, UINT32_MAX, value);
+}
+
+bool http_header_get_color(httpd_req_t *req, const char *field, rgb_color_t *color)
+{
+    uint32_t rgb = UINT32_MAX;
+    if (!http_header_get_number(req, field, 16, 0xFFFFFF, &rgb))
+    {
+        return false;
+    }
+    if (rgb != UINT32_MAX)
+    {
+        color->color_rgb.red = (rgb >> 16) & 0xFF;
+        color->color_rgb.green = (rgb >> 8) & 0xFF;
+        color->color_rgb.blue = rgb & 0xFF;
+    }
+    return true;
+}
+
+/**
+ * @brief Value of a hex digit, -1 if c is none
+ */
+static int http_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Decodes hex digits, str_len has to be twice the number of bytes
+ */
+static bool http_hex_decode(const char *str, size_t str_len, uint8_t *data, size_t len)
+{
+    if (str_len != 2 * len)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; ++i)
+    {
+        int high = http_hex_digit(str[2 * i]);
+        int low = http_hex_digit(str[2 * i + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        data[i] = (uint8_t)(high << 4 | low);
+    }
+    return true;
+}
+
+esp_err_t http_header_get_hex(httpd_req_t *req, const char *field, uint8_t *data, size_t len)
+{
+    char str[HTTP_HEADER_HEX_SIZE];
+    if (2 * len >= sizeof(str))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = http_header_get_str(req, field, str, sizeof(str));
+    if (err != ESP_OK)
+    {
+        return err == ESP_ERR_NOT_FOUND ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_ARG;
+    }
+    return http_hex_decode(str, strlen(str), data, len) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief Parses an unsigned decimal number of a header value
+ *
+ * @param str number, advanced past its digits
+ * @param value pointer where the number is stored
+ * @return true if there are digits and the number fits 32 bits
+ */
+static bool http_parse_uint(const char **str, uint32_t *value)
+{
+    if (**str < '0' || **str > '9')
+    {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    unsigned long number = strtoul(*str, &end, 10);
+    if (errno == ERANGE)
+    {
+        return false;
+    }
+    *str = end;
+    *value = (uint32_t)number;
+    return true;
+}
+
+bool http_header_get_content_range(httpd_req_t *req, uint32_t *first, uint32_t *last, uint32_t *complete)
+{
+    char str[HTTP_HEADER_RANGE_SIZE];
+    esp_err_t err = http_header_get_str(req, "Content-Range", str, sizeof(str));
+    if (err == ESP_ERR_NOT_FOUND)
+    {
+        return true;
+    }
+    if (err != ESP_OK || strncmp(str, "bytes ", 6) != 0)
+    {
+        return false;
+    }
+
+    const char *p = str + 6;
+    uint32_t range_first, range_last, range_complete;
+    if (!http_parse_uint(&p, &range_first) || *p++ != '-' || !http_parse_uint(&p, &range_last) || *p++ != '/' ||
+        !http_parse_uint(&p, &range_complete) || *p != '\0' || range_first > range_last ||
+        range_last >= range_complete)
+    {
+        return false;
+    }
+    *first = range_first;
+    *last = range_last;
+    *complete = range_complete;
+    return true;
+}
+
+char http_json_peek(http_json_reader_t *r)
+{
+    while (r->pos < r->end && (*r->pos == ' ' || *r->pos == '\t' || *r->pos == '\r' || *r->pos == '\n'))
+    {
+        ++r->pos;
+    }
+    return r->pos < r->end ? *r->pos : 0;
+}
+
+bool http_json_accept(http_json_reader_t *r, char c)
+{
+    if (http_json_peek(r) != c)
+    {
+        return false;
+    }
+    ++r->pos;
+    return true;
+}
+
+bool http_json_read_string(http_json_reader_t *r, const char **str, size_t *len)
+{
+    if (!http_json_accept(r, '"'))
+    {
+        return false;
+    }
+    const char *start = r->pos;
+    while (r->pos < r->end && *r->pos != '"')
+    {
+        if (*r->pos == '\\')
+        {
+            return false;
+        }
+        ++r->pos;
+    }
+    if (r->pos == r->end)
+    {
+        return false;
+    }
+    *str = start;
+    *len = r->pos++ - start;
+    return true;
+}
+
+bool http_json_read_uint(http_json_reader_t *r, uint32_t *value)
+{
+    char c = http_json_peek(r);
+    if (c < '0' || c > '9')
+    {
+        return false;
+    }
+    uint64_t number = 0;
+    while (r->pos < r->end && *r->pos >= '0' && *r->pos <= '9')
+    {
+        number = number * 10 + (*r->pos++ - '0');
+        if (number > UINT32_MAX)
+        {
+            return false;
+        }
+    }
+    *value = (uint32_t)number;
+    return true;
+}
+
+bool http_json_read_bool(http_json_reader_t *r, bool *value)
+{
+    http_json_peek(r);
+    size_t left = r->end - r->pos;
+    if (left >= 4 && strncmp(r->pos, "true", 4) == 0)
+    {
+        r->pos += 4;
+        *value = true;
+        return true;
+    }
+    if (left >= 5 && strncmp(r->pos, "false", 5) == 0)
+    {
+        r->pos += 5;
+        *value = false;
+        return true;
+    }
+    return false;
+}
+
+bool http_json_read_hex(http_json_reader_t *r, uint8_t *data, size_t len)
+{
+    const char *str;
+    size_t str_len;
+    return http_json_read_string(r, &str, &str_len) && http_hex_decode(str, str_len, data, len);
+}
+
+bool http_json_skip_value(http_json_reader_t *r)
+{
+    const char *str;
+    size_t len;
+    uint32_t number;
+    bool flag;
+    char c = http_json_peek(r);
+    if (c == '"')
+    {
+        return http_json_read_string(r, &str, &len);
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return http_json_read_uint(r, &number);
+    }
+    return http_json_read_bool(r, &flag);
+}
+
+bool http_json_key_is(const char *key, size_t len, const char *name)
+{
+    return strlen(name) == len && strncmp(key, name, len) == 0;
+}
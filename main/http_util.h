@@ -0,0 +1,208 @@
+#ifndef HTTP_UTIL_H_
+#define HTTP_UTIL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#include "colors.h"
+
+/* Buffer size of JSON replies, longer replies are sent in chunks of this size */
+#define HTTP_JSON_BUFFER_SIZE 256
+
+/**
+ * @brief Streaming JSON writer over a caller-provided buffer.
+ *
+ * @note Writing into a request sends the buffer as a chunk whenever it is full, so replies of any length need
+ *       only the buffer. Without a request the output is bounded by the buffer and a longer one is an error.
+ *       Commas between values are inserted by the writer.
+ */
+typedef struct
+{
+    httpd_req_t *req; /* Request the JSON is sent to, NULL to only fill the buffer */
+    char *buffer;
+    size_t size;
+    size_t len;
+    bool chunked;    /* A chunk was sent already, the rest has to follow as chunks */
+    bool need_comma; /* Next value or key is preceded by a comma */
+    esp_err_t err;   /* First error, further output is dropped */
+} http_json_writer_t;
+
+/**
+ * @brief Starts a JSON document
+ *
+ * @param w writer
+ * @param req request the document is sent to, Content-Type is set to application/json. NULL to write into the
+ *            buffer only.
+ * @param buffer output buffer, NULL if its allocation failed, http_json_finish() replies 500 then
+ * @param size size of the buffer
+ */
+void http_json_init(http_json_writer_t *w, httpd_req_t *req, char *buffer, size_t size);
+
+void http_json_object_begin(http_json_writer_t *w);
+void http_json_object_end(http_json_writer_t *w);
+void http_json_array_begin(http_json_writer_t *w);
+void http_json_array_end(http_json_writer_t *w);
+
+/**
+ * @brief Writes the key of the next object member
+ *
+ * @param w writer
+ * @param key key, written as is so it must not need escaping
+ */
+void http_json_key(http_json_writer_t *w, const char *key);
+
+/**
+ * @brief Writes a string value, quotes, backslashes and control characters are escaped
+ */
+void http_json_string(http_json_writer_t *w, const char *value);
+
+void http_json_int(http_json_writer_t *w, int32_t value);
+void http_json_uint(http_json_writer_t *w, uint32_t value);
+void http_json_bool(http_json_writer_t *w, bool value);
+
+/**
+ * @brief Object members, the key followed by the value
+ */
+void http_json_member_string(http_json_writer_t *w, const char *key, const char *value);
+void http_json_member_int(http_json_writer_t *w, const char *key, int32_t value);
+void http_json_member_uint(http_json_writer_t *w, const char *key, uint32_t value);
+void http_json_member_bool(http_json_writer_t *w, const char *key, bool value);
+
+/**
+ * @brief Finishes the document, the rest of a request reply is sent
+ *
+ * @param w writer
+ * @return
+ *      - ESP_OK: document complete
+ *      - ESP_ERR_INVALID_SIZE: document does not fit the buffer of a writer without request
+ *      - ESP_ERR_NO_MEM: writer has no buffer
+ *      - ESP_FAIL: sending of the reply failed
+ */
+esp_err_t http_json_finish(http_json_writer_t *w);
+
+/**
+ * @brief Cursor of the JSON reader, values are parsed in place without copies
+ *
+ * @note The reader covers the JSON of the request bodies and manifests of this firmware: strings without escape
+ *       sequences, non-negative integers and booleans. The caller walks objects and arrays with http_json_accept().
+ */
+typedef struct
+{
+    const char *pos;
+    const char *end;
+} http_json_reader_t;
+
+/**
+ * @brief Skips white space, returns the next character or 0 at the end of the input
+ */
+char http_json_peek(http_json_reader_t *r);
+
+/**
+ * @brief Consumes the character if it is the next one
+ */
+bool http_json_accept(http_json_reader_t *r, char c);
+
+/**
+ * @brief Parses a string without escape sequences
+ *
+ * @param r reader
+ * @param str pointer to the first character of the string in the input
+ * @param len length of the string
+ * @return true on success
+ */
+bool http_json_read_string(http_json_reader_t *r, const char **str, size_t *len);
+
+/**
+ * @brief Parses a non-negative integer that fits 32 bits
+ */
+bool http_json_read_uint(http_json_reader_t *r, uint32_t *value);
+
+/**
+ * @brief Parses true or false
+ */
+bool http_json_read_bool(http_json_reader_t *r, bool *value);
+
+/**
+ * @brief Parses a string of hex digits, e.g. a SHA-256 digest
+ *
+ * @param r reader
+ * @param data pointer where the bytes are stored
+ * @param len number of bytes, the string holds twice as many hex digits
+ * @return true on success
+ */
+bool http_json_read_hex(http_json_reader_t *r, uint8_t *data, size_t len);
+
+/**
+ * @brief Skips a string, number or boolean, e.g. the value of an unknown key
+ */
+bool http_json_skip_value(http_json_reader_t *r);
+
+/**
+ * @brief Compares a parsed key with a name
+ */
+bool http_json_key_is(const char *key, size_t len, const char *name);
+
+/**
+ * @brief Reads a request header into a caller-provided buffer
+ *
+ * @param req HTTP request
+ * @param field header field
+ * @param buffer output buffer, null-terminated on success
+ * @param size size of the buffer
+ * @return
+ *      - ESP_OK: header was copied
+ *      - ESP_ERR_NOT_FOUND: header is missing or empty
+ *      - ESP_ERR_INVALID_SIZE: value is longer than the buffer
+ */
+esp_err_t http_header_get_str(httpd_req_t *req, const char *field, char *buffer, size_t size);
+
+/**
+ * @brief Reads unsigned decimal number from a request header
+ *
+ * @param req HTTP request
+ * @param field header field
+ * @param value pointer where the number is stored, left untouched if header is missing
+ * @return true if the header is missing or holds a valid number, otherwise false
+ */
+bool http_header_get_uint(httpd_req_t *req, const char *field, uint32_t *value);
+
+/**
+ * @brief Reads color from a request header, the value is hex RRGGBB
+ *
+ * @param req HTTP request
+ * @param field header field
+ * @param color pointer where the color is stored, left untouched if header is missing
+ * @return true if the header is missing or holds a valid color, otherwise false
+ */
+bool http_header_get_color(httpd_req_t *req, const char *field, rgb_color_t *color);
+
+/**
+ * @brief Reads binary data written as hex digits from a request header, e.g. a SHA-256 digest
+ *
+ * @param req HTTP request
+ * @param field header field
+ * @param data pointer where the bytes are stored
+ * @param len number of bytes, the header holds twice as many hex digits
+ * @return
+ *      - ESP_OK: data was read
+ *      - ESP_ERR_NOT_FOUND: header is missing
+ *      - ESP_ERR_INVALID_ARG: header is not len bytes of hex digits
+ */
+esp_err_t http_header_get_hex(httpd_req_t *req, const char *field, uint8_t *data, size_t len);
+
+/**
+ * @brief Reads the Content-Range header of a partial request body, bytes first-last/complete
+ *
+ * @param req HTTP request
+ * @param first pointer where the offset of the first body byte is stored, left untouched if header is missing
+ * @param last pointer where the offset of the last body byte is stored, left untouched if header is missing
+ * @param complete pointer where the length of the whole content is stored, left untouched if header is missing
+ * @return true if the header is missing or holds a valid range, otherwise false
+ */
+bool http_header_get_content_range(httpd_req_t *req, uint32_t *first, uint32_t *last, uint32_t *complete);
+
+#endif /* HTTP_UTIL_H_ */
@@ -0,0 +1,501 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "http_util.h"
+#include "lamp_api.h"
+#include "ws2812_api.h"
+
+_Static_assert(LAMP_API_MAX_BODY >= 3 * WS2812_MAX_LED_COUNT, "binary body of a whole strip has to fit");
+
+/* Tag used for ESP serial console messages */
+static const char *TAG = "lamp_api";
+
+/**
+ * @brief Commands of one request and the colors of its pixel commands
+ */
+typedef struct
+{
+    ws2812_command_t cmds[WS2812_COMMAND_QUEUE_LENGTH];
+    uint32_t count;
+    rgb_color_t pixels[WS2812_MAX_LED_COUNT];
+    uint32_t pixel_count;
+} lamp_api_batch_t;
+
+/* Request body and the batch parsed from it. Handlers run only in the httpd task, so static buffers keep the
+ * request path free of heap allocation */
+static char s_body[LAMP_API_MAX_BODY];
+static lamp_api_batch_t s_batch;
+
+/* Effect parameters overridden by an operation */
+#define LAMP_OP_PERIOD (1 << 0)
+#define LAMP_OP_LENGTH (1 << 1)
+#define LAMP_OP_PRIMARY (1 << 2)
+#define LAMP_OP_SECONDARY (1 << 3)
+
+/**
+ * @brief One operation object of the JSON body
+ */
+typedef struct
+{
+    uint32_t channel;
+    int32_t brightness;    /* -1 if not set */
+    int64_t transition_ms; /* -1 if not set */
+    bool off;
+    bool has_color;
+    rgb_color_t color;
+    bool has_gradient;
+    rgb_color_t gradient[2];
+    int32_t effect; /* -1 if not set */
+    uint32_t effect_fields;
+    ws2812_effect_params_t effect_params;
+    uint32_t start;
+    rgb_color_t *pixels; /* NULL if not set */
+    uint32_t pixel_count;
+} lamp_api_operation_t;
+
+/**
+ * @brief Parses a color string "RRGGBB", optionally prefixed with '#'
+ */
+static bool lamp_json_color(http_json_reader_t *j, rgb_color_t *color)
+{
+    const char *str;
+    size_t len;
+    if (!http_json_read_string(j, &str, &len))
+    {
+        return false;
+    }
+    if (len == 7 && str[0] == '#')
+    {
+        ++str, --len;
+    }
+    if (len != 6)
+    {
+        return false;
+    }
+
+    uint32_t rgb = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        char c = str[i];
+        uint32_t digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            digit = (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        rgb = (rgb << 4) | digit;
+    }
+    color->color_rgb.red = (rgb >> 16) & 0xFF;
+    color->color_rgb.green = (rgb >> 8) & 0xFF;
+    color->color_rgb.blue = rgb & 0xFF;
+    return true;
+}
+
+/**
+ * @brief Parses an array of colors into the pixel pool of the batch
+ */
+static bool lamp_api_parse_pixels(http_json_reader_t *j, lamp_api_operation_t *op, lamp_api_batch_t *batch)
+{
+    /* A second key would start a new run in the pool and leave the first one's pixels in front of it */
+    if (op->pixels != NULL || !http_json_accept(j, '['))
+    {
+        return false;
+    }
+    op->pixels = &batch->pixels[batch->pixel_count];
+    op->pixel_count = 0;
+    if (http_json_accept(j, ']'))
+    {
+        return true;
+    }
+    do
+    {
+        if (batch->pixel_count == WS2812_MAX_LED_COUNT || !lamp_json_color(j, &batch->pixels[batch->pixel_count]))
+        {
+            return false;
+        }
+        ++batch->pixel_count;
+        ++op->pixel_count;
+    } while (http_json_accept(j, ','));
+    return http_json_accept(j, ']');
+}
+
+/**
+ * @brief Parses the effect, given by its registry name or id
+ */
+static bool lamp_api_parse_effect(http_json_reader_t *j, int32_t *effect)
+{
+    if (http_json_peek(j) != '"')
+    {
+        uint32_t id;
+        if (!http_json_read_uint(j, &id) ||
+            (id != WS2812_EFFECT_NONE && ws2812_effect_get((ws2812_effect_e)id) == NULL))
+        {
+            return false;
+        }
+        *effect = (int32_t)id;
+        return true;
+    }
+
+    const char *name;
+    size_t len;
+    if (!http_json_read_string(j, &name, &len))
+    {
+        return false;
+    }
+    if (http_json_key_is(name, len, "none"))
+    {
+        *effect = WS2812_EFFECT_NONE;
+        return true;
+    }
+    for (uint32_t e = 0; e < WS2812_EFFECT_COUNT; ++e)
+    {
+        const ws2812_effect_info_t *info = ws2812_effect_get((ws2812_effect_e)e);
+        if (info != NULL && http_json_key_is(name, len, info->name))
+        {
+            *effect = (int32_t)e;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses one value of an operation object
+ */
+static bool lamp_api_parse_field(http_json_reader_t *j, const char *key, size_t len, lamp_api_operation_t *op,
+                                 lamp_api_batch_t *batch)
+{
+    uint32_t number;
+
+    if (http_json_key_is(key, len, "channel"))
+    {
+        return http_json_read_uint(j, &op->channel) &&
+               (op->channel == WS2812_CHANNEL_ALL || op->channel < ws2812_get_channel_count());
+    }
+    if (http_json_key_is(key, len, "brightness"))
+    {
+        bool valid = http_json_read_uint(j, &number) && number <= UINT8_MAX;
+        op->brightness = (int32_t)number;
+        return valid;
+    }
+    if (http_json_key_is(key, len, "transition_ms"))
+    {
+        bool valid = http_json_read_uint(j, &number);
+        op->transition_ms = number;
+        return valid;
+    }
+    if (http_json_key_is(key, len, "off"))
+    {
+        return http_json_read_bool(j, &op->off);
+    }
+    if (http_json_key_is(key, len, "color"))
+    {
+        op->has_color = true;
+        return lamp_json_color(j, &op->color);
+    }
+    if (http_json_key_is(key, len, "gradient"))
+    {
+        op->has_gradient = true;
+        return http_json_accept(j, '[') && lamp_json_color(j, &op->gradient[0]) && http_json_accept(j, ',') &&
+               lamp_json_color(j, &op->gradient[1]) && http_json_accept(j, ']');
+    }
+    if (http_json_key_is(key, len, "effect"))
+    {
+        return lamp_api_parse_effect(j, &op->effect);
+    }
+    if (http_json_key_is(key, len, "period_ms"))
+    {
+        op->effect_fields |= LAMP_OP_PERIOD;
+        return http_json_read_uint(j, &op->effect_params.period_ms);
+    }
+    if (http_json_key_is(key, len, "length"))
+    {
+        op->effect_fields |= LAMP_OP_LENGTH;
+        bool valid = http_json_read_uint(j, &number) && number <= UINT16_MAX;
+        op->effect_params.length = (uint16_t)number;
+        return valid;
+    }
+    if (http_json_key_is(key, len, "primary"))
+    {
+        op->effect_fields |= LAMP_OP_PRIMARY;
+        return lamp_json_color(j, &op->effect_params.primary);
+    }
+    if (http_json_key_is(key, len, "secondary"))
+    {
+        op->effect_fields |= LAMP_OP_SECONDARY;
+        return lamp_json_color(j, &op->effect_params.secondary);
+    }
+    if (http_json_key_is(key, len, "start"))
+    {
+        return http_json_read_uint(j, &op->start) && op->start < WS2812_MAX_LED_COUNT;
+    }
+    if (http_json_key_is(key, len, "pixels"))
+    {
+        return lamp_api_parse_pixels(j, op, batch);
+    }
+    return false;
+}
+
+/**
+ * @brief Appends a command to the batch
+ */
+static bool lamp_api_add_command(lamp_api_batch_t *batch, const ws2812_command_t *cmd)
+{
+    if (batch->count == WS2812_COMMAND_QUEUE_LENGTH)
+    {
+        return false;
+    }
+    batch->cmds[batch->count++] = *cmd;
+    return true;
+}
+
+/**
+ * @brief Appends commands of the operation to the batch, in the documented order
+ */
+static bool lamp_api_add_operation(lamp_api_batch_t *batch, const lamp_api_operation_t *op)
+{
+    ws2812_command_t cmd = {.channel = (uint8_t)op->channel};
+    bool valid = true;
+
+    if (op->brightness >= 0)
+    {
+        cmd.type = WS2812_CMD_BRIGHTNESS, cmd.brightness = (uint8_t)op->brightness;
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->transition_ms >= 0)
+    {
+        cmd.type = WS2812_CMD_TRANSITION, cmd.transition_ms = (uint32_t)op->transition_ms;
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->off)
+    {
+        cmd.type = WS2812_CMD_OFF;
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->has_color)
+    {
+        cmd.type = WS2812_CMD_COLOR, cmd.color = op->color;
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->has_gradient)
+    {
+        cmd.type = WS2812_CMD_GRADIENT, cmd.gradient.from = op->gradient[0], cmd.gradient.to = op->gradient[1];
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->effect >= 0)
+    {
+        const ws2812_effect_info_t *info = ws2812_effect_get((ws2812_effect_e)op->effect);
+        cmd.type = WS2812_CMD_EFFECT;
+        cmd.effect.effect = (ws2812_effect_e)op->effect;
+        memset(&cmd.effect.params, 0, sizeof(cmd.effect.params));
+        if (info != NULL)
+        {
+            cmd.effect.params = info->default_params;
+        }
+        if (op->effect_fields & LAMP_OP_PERIOD)
+        {
+            cmd.effect.params.period_ms = op->effect_params.period_ms;
+        }
+        if (op->effect_fields & LAMP_OP_LENGTH)
+        {
+            cmd.effect.params.length = op->effect_params.length;
+        }
+        if (op->effect_fields & LAMP_OP_PRIMARY)
+        {
+            cmd.effect.params.primary = op->effect_params.primary;
+        }
+        if (op->effect_fields & LAMP_OP_SECONDARY)
+        {
+            cmd.effect.params.secondary = op->effect_params.secondary;
+        }
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    if (op->pixels != NULL)
+    {
+        cmd.type = WS2812_CMD_PIXELS, cmd.pixels.start = (uint16_t)op->start, cmd.pixels.count = op->pixel_count;
+        valid &= lamp_api_add_command(batch, &cmd);
+    }
+    return valid;
+}
+
+/**
+ * @brief Parses one operation object and appends its commands to the batch
+ */
+static bool lamp_api_parse_operation(http_json_reader_t *j, lamp_api_batch_t *batch)
+{
+    lamp_api_operation_t op = {.channel = WS2812_CHANNEL_ALL, .brightness = -1, .transition_ms = -1, .effect = -1};
+
+    if (!http_json_accept(j, '{'))
+    {
+        return false;
+    }
+    if (!http_json_accept(j, '}'))
+    {
+        do
+        {
+            const char *key;
+            size_t len;
+            if (!http_json_read_string(j, &key, &len) || !http_json_accept(j, ':') ||
+                !lamp_api_parse_field(j, key, len, &op, batch))
+            {
+                return false;
+            }
+        } while (http_json_accept(j, ','));
+        if (!http_json_accept(j, '}'))
+        {
+            return false;
+        }
+    }
+    return lamp_api_add_operation(batch, &op);
+}
+
+/**
+ * @brief Parses the JSON body, one operation object or an array of them
+ */
+static bool lamp_api_parse_json(const char *body, size_t len, lamp_api_batch_t *batch)
+{
+    http_json_reader_t j = {.pos = body, .end = body + len};
+
+    if (!http_json_accept(&j, '['))
+    {
+        return lamp_api_parse_operation(&j, batch) && http_json_peek(&j) == 0;
+    }
+    if (http_json_accept(&j, ']'))
+    {
+        return http_json_peek(&j) == 0;
+    }
+    do
+    {
+        if (!lamp_api_parse_operation(&j, batch))
+        {
+            return false;
+        }
+    } while (http_json_accept(&j, ','));
+    return http_json_accept(&j, ']') && http_json_peek(&j) == 0;
+}
+
+/**
+ * @brief Parses the binary body, raw R, G, B bytes of consecutive pixels
+ */
+static bool lamp_api_parse_binary(httpd_req_t *req, const uint8_t *body, size_t len, lamp_api_batch_t *batch)
+{
+    uint32_t channel = WS2812_CHANNEL_ALL;
+    uint32_t start = 0;
+
+    if (len % 3 != 0 || !http_header_get_uint(req, "lamp-channel", &channel) ||
+        !http_header_get_uint(req, "lamp-start", &start) || start >= WS2812_MAX_LED_COUNT ||
+        (channel != WS2812_CHANNEL_ALL && channel >= ws2812_get_channel_count()))
+    {
+        return false;
+    }
+
+    /* The body limit holds more pixels than the pool, so the count is bounded here */
+    uint32_t count = len / 3;
+    if (count == 0 || count > WS2812_MAX_LED_COUNT - start)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i, body += 3)
+    {
+        batch->pixels[i].color_rgb.red = body[0];
+        batch->pixels[i].color_rgb.green = body[1];
+        batch->pixels[i].color_rgb.blue = body[2];
+    }
+    batch->pixel_count = count;
+
+    ws2812_command_t cmd = {
+        .type = WS2812_CMD_PIXELS, .channel = (uint8_t)channel, .pixels = {.start = start, .count = count}};
+    return lamp_api_add_command(batch, &cmd);
+}
+
+/**
+ * @brief Receives the whole request body into s_body
+ *
+ * @return true on success, false if the connection failed
+ */
+static bool lamp_api_receive_body(httpd_req_t *req)
+{
+    size_t received = 0;
+
+    while (received < req->content_len)
+    {
+        int len = httpd_req_recv(req, s_body + received, req->content_len - received);
+        if (len == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            continue;
+        }
+        if (len <= 0)
+        {
+            return false;
+        }
+        received += len;
+    }
+    return true;
+}
+
+/**
+ * @brief /api/lamp POST handler, applies the whole request in one frame
+ *
+ * @param req HTTP request for which uri is need to be handled.
+ * @return ESP_OK, ESP_FAIL to close the connection
+ */
+static esp_err_t lamp_api_post_handler(httpd_req_t *req)
+{
+    if (req->content_len > sizeof(s_body))
+    {
+        httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Lamp request too long");
+        return ESP_FAIL;
+    }
+    if (!lamp_api_receive_body(req))
+    {
+        return ESP_FAIL;
+    }
+
+    char content_type[32] = "";
+    http_header_get_str(req, "Content-Type", content_type, sizeof(content_type));
+
+    s_batch.count = 0;
+    s_batch.pixel_count = 0;
+    bool valid = strncmp(content_type, "application/octet-stream", strlen("application/octet-stream")) == 0
+                     ? lamp_api_parse_binary(req, (const uint8_t *)s_body, req->content_len, &s_batch)
+                     : lamp_api_parse_json(s_body, req->content_len, &s_batch);
+    if (!valid)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid lamp request");
+        return ESP_OK;
+    }
+
+    esp_err_t err = ws2812_send_batch(s_batch.cmds, s_batch.count, s_batch.pixels);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "lamp batch of %lu commands rejected: %s", (unsigned long)s_batch.count, esp_err_to_name(err));
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_sendstr(req, "Lamp is not ready");
+        return ESP_OK;
+    }
+
+    /* Requests come at high rate, logging them on the UART would dominate the response time */
+    ESP_LOGD(TAG, "lamp batch of %lu commands queued", (unsigned long)s_batch.count);
+    httpd_resp_set_status(req, HTTPD_204);
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
+
+void lamp_api_register_handlers(httpd_handle_t server)
+{
+    httpd_uri_t lamp_uri = {
+        .uri = "/api/lamp",
+        .method = HTTP_POST,
+        .handler = lamp_api_post_handler,
+    };
+    httpd_register_uri_handler(server, &lamp_uri);
+}
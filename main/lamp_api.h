@@ -0,0 +1,33 @@
+#ifndef LAMP_API_H_
+#define LAMP_API_H_
+
+#include "esp_http_server.h"
+
+/* Longest accepted request body, a binary body holds up to WS2812_MAX_LED_COUNT pixels */
+#define LAMP_API_MAX_BODY 4096
+
+/**
+ * @brief Registers the /api/lamp handlers on the HTTP server
+ *
+ * @note POST /api/lamp with Content-Type application/json takes one operation object or an array of them:
+ *
+ *       [{"channel":0,"effect":"none"},{"channel":0,"start":10,"pixels":["FF0000","00FF00"]},{"brightness":128}]
+ *
+ *       Keys of an operation are channel (index, all channels by default), brightness, transition_ms, off (true),
+ *       color ("RRGGBB"), gradient (["RRGGBB","RRGGBB"]), effect (name or id, with optional period_ms, length,
+ *       primary and secondary), pixels (array of "RRGGBB") and start (first pixel, 0 by default). Several keys of
+ *       one operation are applied in this order.
+ *
+ *       With Content-Type application/octet-stream the body is raw pixel data, 3 bytes R, G, B per pixel, written
+ *       from the pixel in lamp-start header (0 by default) of the channel in lamp-channel header (all by default).
+ *       Pixels past WS2812_MAX_LED_COUNT make the request invalid.
+ *
+ *       The whole request is applied in one frame. Pixels do not stop a running effect, "effect":"none" does.
+ *       Replies 204 on success, 400 for an invalid request, 413 for a too long body and 503 if the strips are
+ *       not initialized. A full command queue discards its oldest commands, the request always lands.
+ *
+ * @param server HTTP server handle
+ */
+void lamp_api_register_handlers(httpd_handle_t server);
+
+#endif /* LAMP_API_H_ */
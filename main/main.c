@@ -1,15 +1,129 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "nvs_flash.h"
 
+#include "app_nvs.h"
+#include "app_state.h"
+#include "boot_profile.h"
+#include "tasks_common.h"
 #include "ws2812_api.h"
 #include "wifi_app.h"
 
 #define GPIO_INPUT_BUTTON 35
 #define GPIO_INPUT_BITMASK (1ULL << GPIO_INPUT_BUTTON)
 
+/* The lamp state is saved once it has not changed for this long, so a dimming slider does not wear the flash */
+#define LAMP_SAVE_DELAY_MS 3000
+
+/* Lamp state in NVS, compared before saving */
+static ws2812_lamp_state_t s_saved_lamp;
+static TaskHandle_t s_lamp_save_task = NULL;
+
+/**
+ * @brief Lamp save task: saves the lamp state once it has not changed for LAMP_SAVE_DELAY_MS and differs from the
+ *        saved one
+ *
+ * @note The NVS write and commit take tens of ms, they run here instead of the esp_timer task which also wakes up
+ *       the render task every frame.
+ *
+ * @param pvParameters parameter which can be passed to the task
+ */
+static void lamp_save_task(void *pvParameters)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        /* Every change notified meanwhile restarts the delay */
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LAMP_SAVE_DELAY_MS)) > 0)
+        {
+        }
+
+        ws2812_lamp_state_t lamp;
+        ws2812_get_lamp_state(&lamp);
+        if (memcmp(&lamp, &s_saved_lamp, sizeof(lamp)) != 0 && app_nvs_save_lamp_state(&lamp) == ESP_OK)
+        {
+            s_saved_lamp = lamp;
+        }
+    }
+}
+
+/**
+ * @brief Lamp state subscriber, notifies the save task which restarts its delay on every change
+ */
+static void lamp_state_subscriber(const app_state_t *state, uint32_t topics, void *ctx)
+{
+    xTaskNotifyGive(s_lamp_save_task);
+}
+
+/**
+ * @brief Shows the lamp state saved before the last power off, warm white if nothing is saved.
+ *
+ * @note Queued as one batch right after the render task starts, so the light is on before the Wi-Fi stack is
+ *       initialized. The still frame of each channel, its last solid color or gradient, is replayed and the effects
+ *       are restored with their parameters on top of it. Channels without a saved state come on warm white.
+ */
+static void lamp_restore_state()
+{
+    ws2812_command_t cmds[1 + 2 * WS2812_MAX_CHANNELS];
+    uint32_t count = 0;
+
+    if (!app_nvs_load_lamp_state(&s_saved_lamp))
+    {
+        memset(&s_saved_lamp, 0, sizeof(s_saved_lamp));
+        s_saved_lamp.brightness = ws2812_get_brightness();
+    }
+
+    cmds[count++] = (ws2812_command_t){.type = WS2812_CMD_BRIGHTNESS, .brightness = s_saved_lamp.brightness};
+    for (uint8_t c = 0; c < ws2812_get_channel_count(); ++c)
+    {
+        if (c >= s_saved_lamp.channel_count)
+        {
+            cmds[count++] = (ws2812_command_t){
+                .type = WS2812_CMD_COLOR, .channel = c, .color = color_to_rgb_struct(color_WARM_WHITE)};
+        }
+        else if (memcmp(&s_saved_lamp.still[c].from, &s_saved_lamp.still[c].to, sizeof(rgb_color_t)) == 0)
+        {
+            cmds[count++] =
+                (ws2812_command_t){.type = WS2812_CMD_COLOR, .channel = c, .color = s_saved_lamp.still[c].to};
+        }
+        else
+        {
+            cmds[count++] = (ws2812_command_t){
+                .type = WS2812_CMD_GRADIENT,
+                .channel = c,
+                .gradient = {.from = s_saved_lamp.still[c].from, .to = s_saved_lamp.still[c].to},
+            };
+        }
+
+        if (c < s_saved_lamp.channel_count && s_saved_lamp.effect[c] != WS2812_EFFECT_NONE &&
+            s_saved_lamp.effect[c] < WS2812_EFFECT_COUNT)
+        {
+            cmds[count++] = (ws2812_command_t){
+                .type = WS2812_CMD_EFFECT,
+                .channel = c,
+                .effect = {.effect = s_saved_lamp.effect[c], .params = s_saved_lamp.effect_params[c]},
+            };
+        }
+    }
+
+    boot_profile_begin(BOOT_PHASE_LIGHT_ON);
+    ws2812_send_batch(cmds, count, NULL);
+
+    if (xTaskCreatePinnedToCore(lamp_save_task, "lamp_save_task", LAMP_SAVE_TASK_STACK_SIZE, NULL,
+                                LAMP_SAVE_TASK_PRIORITY, &s_lamp_save_task, LAMP_SAVE_TASK_CORE_ID) == pdPASS)
+    {
+        app_state_subscribe(APP_STATE_TOPIC_LAMP, lamp_state_subscriber, NULL);
+    }
+}
+
 void app_main(void)
 {
+    boot_profile_end(BOOT_PHASE_STARTUP);
 
     // Initialize NVS
+    boot_profile_begin(BOOT_PHASE_NVS);
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
     {
@@ -17,9 +131,27 @@ void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_profile_end(BOOT_PHASE_NVS);
+
+    // Start the state task before the producers publish to it
+    ESP_ERROR_CHECK(app_state_init());
+
+    // Initialize the led strips with the geometry saved in NVS, channel 0 always exists,
+    // the following ones up to the first channel without valid configuration
+    boot_profile_begin(BOOT_PHASE_LAMP_INIT);
+    ws2812_strip_config_t strip_configs[WS2812_MAX_CHANNELS];
+    uint8_t channel_count = 1;
+    app_nvs_load_strip_config(0, &strip_configs[0]);
+    while (channel_count < WS2812_MAX_CHANNELS &&
+           app_nvs_load_strip_config(channel_count, &strip_configs[channel_count]))
+    {
+        channel_count++;
+    }
+    ESP_ERROR_CHECK(init_ws2812(strip_configs, channel_count));
+    // Light on before WiFi, the render task runs on the other core while the WiFi stack starts
+    lamp_restore_state();
+    boot_profile_end(BOOT_PHASE_LAMP_INIT);
 
-    led_strip_handle_t led_strip = {NULL};
-    ESP_ERROR_CHECK(init_ws2812(&led_strip));
     // Start WiFi
-    wifi_app_start(led_strip);
+    wifi_app_start();
 }
@@ -0,0 +1,243 @@
+#include <string.h>
+#include <strings.h>
+
+#include "multipart.h"
+
+/* The first delimiter usually starts the body without the leading CRLF, the parser starts as if it was seen */
+#define MULTIPART_DELIMITER_CRLF_LEN 2
+
+/**
+ * @brief Finds the boundary parameter value of a Content-Type header value
+ *
+ * @param content_type header value
+ * @param len pointer where the value length is stored
+ * @return value, NULL if there is no boundary parameter
+ */
+static const char *multipart_find_boundary(const char *content_type, size_t *len)
+{
+    const char *param = strchr(content_type, ';');
+    while (param != NULL)
+    {
+        param += strspn(param + 1, " \t") + 1;
+        if (strncasecmp(param, "boundary=", 9) == 0)
+        {
+            const char *value = param + 9;
+            if (*value == '"')
+            {
+                const char *quote = strchr(++value, '"');
+                *len = quote != NULL ? (size_t)(quote - value) : 0;
+            }
+            else
+            {
+                *len = strcspn(value, "; \t");
+            }
+            return value;
+        }
+        param = strchr(param, ';');
+    }
+    return NULL;
+}
+
+esp_err_t multipart_parser_init(multipart_parser_t *p, const char *content_type, multipart_data_cb_t on_data,
+                                void *ctx)
+{
+    memset(p, 0, sizeof(*p));
+    p->state = MULTIPART_STATE_ERROR;
+    if (content_type == NULL || strncasecmp(content_type, "multipart/", 10) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t len = 0;
+    const char *boundary = multipart_find_boundary(content_type, &len);
+    /* The body search relies on CR appearing only as the first delimiter byte */
+    if (boundary == NULL || len == 0 || len > MULTIPART_BOUNDARY_MAX || memchr(boundary, '\r', len) != NULL ||
+        memchr(boundary, '\n', len) != NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(p->delimiter, "\r\n--", 4);
+    memcpy(p->delimiter + 4, boundary, len);
+    p->delimiter_len = (uint8_t)(len + 4);
+    p->match = MULTIPART_DELIMITER_CRLF_LEN;
+    p->on_data = on_data;
+    p->ctx = ctx;
+    p->state = MULTIPART_STATE_PREAMBLE;
+    return ESP_OK;
+}
+
+/**
+ * @brief Passes body bytes to the callback, bytes of the preamble are dropped
+ */
+static esp_err_t multipart_emit(multipart_parser_t *p, const char *data, size_t len)
+{
+    if (len == 0 || p->state != MULTIPART_STATE_BODY)
+    {
+        return ESP_OK;
+    }
+    return p->on_data(p->ctx, data, len);
+}
+
+/**
+ * @brief Searches the delimiter in the preamble or in a part body
+ *
+ * @note Bytes before the delimiter are emitted in one run per chunk. A partial match at the end of the chunk is
+ *       held back in p->match. If the next chunk does not complete it, the held back bytes equal the delimiter
+ *       prefix, so they are emitted from p->delimiter and nothing is copied.
+ *
+ * @param p parser
+ * @param data chunk
+ * @param len chunk length
+ * @param pos position in the chunk, advanced past the delimiter if it was found, otherwise to len
+ * @return ESP_OK or error of the callback
+ */
+static esp_err_t multipart_find_delimiter(multipart_parser_t *p, const char *data, size_t len, size_t *pos)
+{
+    size_t held = p->match; /* Matched bytes of previous chunks */
+    size_t run = *pos;      /* First byte of this chunk not emitted yet */
+    size_t i = *pos;
+    esp_err_t err = ESP_OK;
+
+    while (i < len)
+    {
+        if (p->match == 0)
+        {
+            const char *cr = memchr(data + i, '\r', len - i);
+            if (cr == NULL)
+            {
+                i = len;
+                break;
+            }
+            i = cr - data;
+        }
+
+        size_t begin = i - (p->match - held); /* Delimiter start in this chunk */
+        while (i < len && p->match < p->delimiter_len && data[i] == p->delimiter[p->match])
+        {
+            ++p->match;
+            ++i;
+        }
+        if (p->match == p->delimiter_len)
+        {
+            err = multipart_emit(p, data + run, begin - run);
+            p->match = 0;
+            *pos = i;
+            p->state = err == ESP_OK ? MULTIPART_STATE_DELIMITER_END : MULTIPART_STATE_ERROR;
+            return err;
+        }
+        if (i == len)
+        {
+            break;
+        }
+
+        /* Mismatch, matched bytes of this chunk stay in the run, held back ones are emitted first */
+        if (held > 0)
+        {
+            err = multipart_emit(p, p->delimiter, held);
+            held = 0;
+            if (err != ESP_OK)
+            {
+                p->state = MULTIPART_STATE_ERROR;
+                return err;
+            }
+        }
+        /* No CR inside the delimiter, only data[i] itself can start the next one */
+        p->match = 0;
+    }
+
+    /* Held back bytes stay held back if the whole chunk continued the match */
+    err = multipart_emit(p, data + run, len - (p->match - held) - run);
+    *pos = len;
+    if (err != ESP_OK)
+    {
+        p->state = MULTIPART_STATE_ERROR;
+    }
+    return err;
+}
+
+esp_err_t multipart_parser_feed(multipart_parser_t *p, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        switch (p->state)
+        {
+        case MULTIPART_STATE_PREAMBLE:
+        case MULTIPART_STATE_BODY: {
+            esp_err_t err = multipart_find_delimiter(p, data, len, &i);
+            if (err != ESP_OK)
+            {
+                return err;
+            }
+            break;
+        }
+        case MULTIPART_STATE_DELIMITER_END:
+            /* Transport padding may follow the delimiter */
+            if (data[i] == '-')
+            {
+                p->state = MULTIPART_STATE_CLOSE;
+            }
+            else if (data[i] == '\r')
+            {
+                p->state = MULTIPART_STATE_DELIMITER_LF;
+            }
+            else if (data[i] != ' ' && data[i] != '\t')
+            {
+                p->state = MULTIPART_STATE_ERROR;
+            }
+            ++i;
+            break;
+        case MULTIPART_STATE_CLOSE:
+            p->state = data[i++] == '-' ? MULTIPART_STATE_EPILOGUE : MULTIPART_STATE_ERROR;
+            break;
+        case MULTIPART_STATE_DELIMITER_LF:
+            p->state = data[i++] == '\n' ? MULTIPART_STATE_HEADERS : MULTIPART_STATE_ERROR;
+            p->line_len = 0;
+            break;
+        case MULTIPART_STATE_HEADERS:
+            if (data[i++] == '\r')
+            {
+                p->state = MULTIPART_STATE_HEADER_LF;
+            }
+            else if (p->line_len < UINT16_MAX)
+            {
+                ++p->line_len;
+            }
+            break;
+        case MULTIPART_STATE_HEADER_LF:
+            if (data[i++] != '\n')
+            {
+                p->state = MULTIPART_STATE_ERROR;
+            }
+            else if (p->line_len == 0)
+            {
+                /* Empty line ends the headers */
+                p->state = MULTIPART_STATE_BODY;
+                ++p->parts;
+            }
+            else
+            {
+                p->state = MULTIPART_STATE_HEADERS;
+                p->line_len = 0;
+            }
+            break;
+        case MULTIPART_STATE_EPILOGUE:
+            return ESP_OK;
+        case MULTIPART_STATE_ERROR:
+        default:
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    return p->state == MULTIPART_STATE_ERROR ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+size_t multipart_parser_get_held(const multipart_parser_t *p)
+{
+    return p->state == MULTIPART_STATE_BODY ? p->match : 0;
+}
+
+bool multipart_parser_is_done(const multipart_parser_t *p)
+{
+    return p->state == MULTIPART_STATE_EPILOGUE;
+}
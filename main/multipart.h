@@ -0,0 +1,99 @@
+#ifndef MULTIPART_H_
+#define MULTIPART_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Longest boundary allowed by RFC 2046 */
+#define MULTIPART_BOUNDARY_MAX 70
+
+/**
+ * @brief Receives body bytes of the parts, data points into the buffer passed to multipart_parser_feed()
+ *
+ * @param ctx context passed to multipart_parser_init()
+ * @param data body bytes
+ * @param len number of bytes, never 0
+ * @return ESP_OK to continue, other errors stop the parser and are returned by multipart_parser_feed()
+ */
+typedef esp_err_t (*multipart_data_cb_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Parser state
+ */
+typedef enum
+{
+    MULTIPART_STATE_PREAMBLE = 0,  /* Skipping bytes before the first delimiter */
+    MULTIPART_STATE_DELIMITER_END, /* After a delimiter, "--" closes the body, CRLF starts part headers */
+    MULTIPART_STATE_CLOSE,         /* Second dash of the close delimiter */
+    MULTIPART_STATE_DELIMITER_LF,  /* LF of the CRLF after a delimiter */
+    MULTIPART_STATE_HEADERS,       /* Part header lines */
+    MULTIPART_STATE_HEADER_LF,     /* LF of a header line, an empty line starts the body */
+    MULTIPART_STATE_BODY,          /* Part body, searching the next delimiter */
+    MULTIPART_STATE_EPILOGUE,      /* Close delimiter seen, the rest is ignored */
+    MULTIPART_STATE_ERROR,
+} multipart_state_e;
+
+/**
+ * @brief Incremental multipart/form-data parser.
+ *
+ * @note Input is fed in chunks split at any byte. Body bytes are passed to the callback as pointers into the fed
+ *       chunk, only a delimiter prefix at the end of a chunk is held back until the next chunk tells whether it is
+ *       the delimiter. Part headers are skipped.
+ */
+typedef struct
+{
+    multipart_state_e state;
+    multipart_data_cb_t on_data;
+    void *ctx;
+    char delimiter[MULTIPART_BOUNDARY_MAX + 4]; /* CRLF "--" boundary */
+    uint8_t delimiter_len;
+    uint8_t match;     /* Delimiter bytes matched so far */
+    uint16_t line_len; /* Length of the current header line */
+    uint32_t parts;    /* Parts whose body started */
+} multipart_parser_t;
+
+/**
+ * @brief Initializes the parser with the boundary of a Content-Type header value
+ *
+ * @param p parser
+ * @param content_type Content-Type header value, e.g. multipart/form-data; boundary=----WebKitFormBoundary
+ * @param on_data callback receiving the body bytes
+ * @param ctx context passed to the callback
+ * @return
+ *      - ESP_OK: parser is ready
+ *      - ESP_ERR_INVALID_ARG: not multipart or no valid boundary
+ */
+esp_err_t multipart_parser_init(multipart_parser_t *p, const char *content_type, multipart_data_cb_t on_data,
+                                void *ctx);
+
+/**
+ * @brief Parses the next chunk of the request body
+ *
+ * @param p parser
+ * @param data chunk
+ * @param len chunk length
+ * @return
+ *      - ESP_OK: chunk consumed
+ *      - ESP_ERR_INVALID_STATE: body is malformed, or an earlier chunk failed
+ *      - other: error returned by the callback
+ */
+esp_err_t multipart_parser_feed(multipart_parser_t *p, const char *data, size_t len);
+
+/**
+ * @brief Number of body bytes held back as a possible delimiter start at the end of the last chunk
+ *
+ * @note They are passed to the callback before the body bytes of the next chunk, unless the delimiter completes.
+ *       A receiver filling its own buffer leaves this gap in front of the next chunk, then every body byte lands
+ *       where the callback appends it and nothing needs to be moved.
+ */
+size_t multipart_parser_get_held(const multipart_parser_t *p);
+
+/**
+ * @brief Check if the close delimiter was parsed, otherwise the body is truncated
+ */
+bool multipart_parser_is_done(const multipart_parser_t *p);
+
+#endif /* MULTIPART_H_ */
@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_app_desc.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sys/param.h"
+
+#include "app_nvs.h"
+#include "app_state.h"
+#include "http_util.h"
+#include "ota_pull.h"
+#include "ota_writer.h"
+#include "tasks_common.h"
+
+/* Tag used for ESP serial console messages */
+static const char *TAG = "ota_pull";
+
+/* Members of the manifest, all are required */
+#define OTA_PULL_FIELD_VERSION (1 << 0)
+#define OTA_PULL_FIELD_URL (1 << 1)
+#define OTA_PULL_FIELD_SIZE (1 << 2)
+#define OTA_PULL_FIELD_SHA256 (1 << 3)
+#define OTA_PULL_FIELDS_ALL (OTA_PULL_FIELD_VERSION | OTA_PULL_FIELD_URL | OTA_PULL_FIELD_SIZE | OTA_PULL_FIELD_SHA256)
+
+/**
+ * @brief Update described by the manifest
+ */
+typedef struct
+{
+    char version[OTA_PULL_VERSION_SIZE];
+    char url[OTA_PULL_URL_SIZE]; /* Absolute image URL */
+    uint32_t size;
+    uint8_t sha256[OTA_WRITER_SHA256_LEN];
+} ota_pull_manifest_t;
+
+/* Only one pull runs at a time, so its buffers are static and the task stack stays small */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_running = false;
+static volatile ota_pull_state_e s_state = OTA_PULL_STATE_IDLE;
+static char s_manifest_url[OTA_PULL_URL_SIZE];
+static char s_body[OTA_PULL_MANIFEST_SIZE];
+static ota_pull_manifest_t s_manifest;
+
+/**
+ * @brief Sets the pull state and publishes it with the OTA state
+ */
+static void ota_pull_set_state(ota_pull_state_e state)
+{
+    s_state = state;
+    app_state_publish(APP_STATE_TOPIC_OTA);
+}
+
+/**
+ * @brief Resolves the image URL of the manifest against the manifest URL
+ *
+ * @param base manifest URL
+ * @param ref absolute URL, absolute path or path relative to the manifest
+ * @param ref_len length of ref
+ * @param url buffer where the null-terminated URL is stored
+ * @param size size of the buffer
+ * @return true if the URL fits the buffer
+ */
+static bool ota_pull_resolve_url(const char *base, const char *ref, size_t ref_len, char *url, size_t size)
+{
+    const char *authority = strstr(base, "://");
+    size_t prefix_len = 0;
+    const char *separator = "";
+
+    /* ref is not null-terminated, it points into the manifest */
+    size_t scheme_len = 0;
+    while (scheme_len < ref_len && ref[scheme_len] != ':' && ref[scheme_len] != '/')
+    {
+        ++scheme_len;
+    }
+
+    if (scheme_len < ref_len && ref[scheme_len] == ':')
+    {
+        /* Scheme before the first slash, the URL is absolute */
+        prefix_len = 0;
+    }
+    else if (authority == NULL)
+    {
+        return false;
+    }
+    else if (ref_len > 0 && ref[0] == '/')
+    {
+        prefix_len = authority + 3 + strcspn(authority + 3, "/") - base;
+    }
+    else
+    {
+        const char *slash = strrchr(authority + 3, '/');
+        prefix_len = slash != NULL ? (size_t)(slash + 1 - base) : strlen(base);
+        separator = slash != NULL ? "" : "/";
+    }
+
+    int len = snprintf(url, size, "%.*s%s%.*s", (int)prefix_len, base, separator, (int)ref_len, ref);
+    return len > 0 && (size_t)len < size;
+}
+
+/**
+ * @brief Parses the manifest JSON object, unknown members are skipped
+ *
+ * @param body manifest
+ * @param len length of the manifest
+ * @param manifest pointer where the update is stored
+ * @return true if all members are present and valid
+ */
+static bool ota_pull_parse_manifest(const char *body, size_t len, ota_pull_manifest_t *manifest)
+{
+    http_json_reader_t j = {.pos = body, .end = body + len};
+    uint32_t fields = 0;
+
+    memset(manifest, 0, sizeof(*manifest));
+    if (!http_json_accept(&j, '{'))
+    {
+        return false;
+    }
+    do
+    {
+        const char *key;
+        size_t key_len;
+        const char *str;
+        size_t str_len;
+        bool valid;
+        if (!http_json_read_string(&j, &key, &key_len) || !http_json_accept(&j, ':'))
+        {
+            return false;
+        }
+
+        if (http_json_key_is(key, key_len, "version"))
+        {
+            valid = http_json_read_string(&j, &str, &str_len) && str_len < sizeof(manifest->version);
+            if (valid)
+            {
+                memcpy(manifest->version, str, str_len);
+                fields |= OTA_PULL_FIELD_VERSION;
+            }
+        }
+        else if (http_json_key_is(key, key_len, "url"))
+        {
+            valid = http_json_read_string(&j, &str, &str_len) && str_len > 0 &&
+                    ota_pull_resolve_url(s_manifest_url, str, str_len, manifest->url, sizeof(manifest->url));
+            fields |= OTA_PULL_FIELD_URL;
+        }
+        else if (http_json_key_is(key, key_len, "size"))
+        {
+            valid = http_json_read_uint(&j, &manifest->size) && manifest->size > 0;
+            fields |= OTA_PULL_FIELD_SIZE;
+        }
+        else if (http_json_key_is(key, key_len, "sha256"))
+        {
+            valid = http_json_read_hex(&j, manifest->sha256, sizeof(manifest->sha256));
+            fields |= OTA_PULL_FIELD_SHA256;
+        }
+        else
+        {
+            valid = http_json_skip_value(&j);
+        }
+        if (!valid)
+        {
+            ESP_LOGW(TAG, "manifest: invalid value of \"%.*s\"", (int)key_len, key);
+            return false;
+        }
+    } while (http_json_accept(&j, ','));
+
+    return http_json_accept(&j, '}') && http_json_peek(&j) == 0 && fields == OTA_PULL_FIELDS_ALL;
+}
+
+/**
+ * @brief Downloads and parses the manifest
+ *
+ * @param manifest pointer where the update is stored
+ * @return
+ *      - ESP_OK: manifest is valid
+ *      - ESP_ERR_INVALID_RESPONSE: HTTP status is not 200 or the manifest is not valid
+ *      - ESP_ERR_INVALID_SIZE: manifest is longer than OTA_PULL_MANIFEST_SIZE
+ *      - other: error of the HTTP client
+ */
+static esp_err_t ota_pull_fetch_manifest(ota_pull_manifest_t *manifest)
+{
+    esp_http_client_config_t config = {.url = s_manifest_url, .timeout_ms = OTA_PULL_TIMEOUT_MS};
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    size_t len = 0;
+
+    if (client == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK)
+    {
+        esp_http_client_fetch_headers(client);
+        if (esp_http_client_get_status_code(client) != 200)
+        {
+            ESP_LOGW(TAG, "manifest: HTTP status %d", esp_http_client_get_status_code(client));
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    while (err == ESP_OK && len < sizeof(s_body))
+    {
+        int read_len = esp_http_client_read(client, s_body + len, sizeof(s_body) - len);
+        if (read_len < 0)
+        {
+            err = ESP_FAIL;
+        }
+        else if (read_len == 0)
+        {
+            break;
+        }
+        else
+        {
+            len += read_len;
+        }
+    }
+    if (err == ESP_OK && !esp_http_client_is_complete_data_received(client))
+    {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    esp_http_client_cleanup(client);
+
+    if (err == ESP_OK && !ota_pull_parse_manifest(s_body, len, manifest))
+    {
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    return err;
+}
+
+/**
+ * @brief Streams the response body into OTA writer slots, runs between ota_writer_begin() and ota_writer_finish()
+ *
+ * @param client HTTP client with the response headers fetched
+ * @param total bytes of the image the response holds
+ * @return ESP_OK if all bytes were received, ESP_ERR_INVALID_SIZE if the connection closed early, otherwise the
+ *         error of a flash write
+ */
+static esp_err_t ota_pull_receive(esp_http_client_handle_t client, uint32_t total)
+{
+    uint32_t received = 0;
+    size_t len = 0;
+    esp_err_t err = ESP_OK;
+    int64_t last_push_us = esp_timer_get_time();
+
+    char *slot = ota_writer_acquire();
+    while (received < total && slot != NULL)
+    {
+        if (len == OTA_WRITER_SLOT_SIZE)
+        {
+            err = ota_writer_submit(slot, len);
+            slot = err == ESP_OK ? ota_writer_acquire() : NULL;
+            len = 0;
+            continue;
+        }
+
+        /* The client reads straight into the slot, the slot is the only copy of the data */
+        int64_t receive_start_us = esp_timer_get_time();
+        int read_len = esp_http_client_read(client, slot + len, MIN(OTA_WRITER_SLOT_SIZE - len, total - received));
+        int64_t now_us = esp_timer_get_time();
+        if (read_len <= 0)
+        {
+            break;
+        }
+        received += read_len;
+        len += read_len;
+        ota_writer_add_received(read_len, now_us - receive_start_us);
+
+        if (now_us - last_push_us >= OTA_PULL_PUSH_PERIOD_MS * 1000)
+        {
+            last_push_us = now_us;
+            app_state_publish(APP_STATE_TOPIC_OTA);
+        }
+    }
+    /* Everything received is written, a download which broke off continues from there */
+    if (slot != NULL)
+    {
+        ota_writer_submit(slot, len);
+    }
+    /* Flash write errors surface here, also when they stopped the loop above */
+    esp_err_t finish_err = ota_writer_finish();
+    if (finish_err != ESP_OK)
+    {
+        return finish_err;
+    }
+    return err != ESP_OK || received == total ? err : ESP_ERR_INVALID_SIZE;
+}
+
+/**
+ * @brief Downloads the missing part of the image into the update partition
+ *
+ * @param manifest update
+ * @return ESP_OK if the whole image is in the flash, otherwise the error of the request or the OTA writer
+ */
+static esp_err_t ota_pull_download(const ota_pull_manifest_t *manifest)
+{
+    esp_http_client_config_t config = {
+        .url = manifest->url, .timeout_ms = OTA_PULL_TIMEOUT_MS, .buffer_size = OTA_PULL_HTTP_BUFFER_SIZE};
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    uint32_t offset = ota_writer_get_resume_offset(manifest->sha256, manifest->size);
+
+    if (client == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (offset > 0)
+    {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%lu-", offset);
+        esp_http_client_set_header(client, "Range", range);
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK)
+    {
+        int64_t content_length = esp_http_client_fetch_headers(client);
+        int status = esp_http_client_get_status_code(client);
+        if (status == 200 && offset > 0)
+        {
+            ESP_LOGW(TAG, "server does not support ranges, the image starts over");
+            offset = 0;
+        }
+        if ((status != 200 && status != 206) || (status == 206 && offset == 0))
+        {
+            ESP_LOGW(TAG, "image: HTTP status %d", status);
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+        else if (content_length > 0 && content_length != manifest->size - offset)
+        {
+            ESP_LOGW(TAG, "image: %lld bytes from byte %lu, the manifest has %lu", content_length, offset,
+                     manifest->size);
+            err = ESP_ERR_INVALID_SIZE;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = ota_writer_begin(manifest->sha256, manifest->size, offset, manifest->size - offset);
+    }
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "downloading bytes %lu-%lu of %s", offset, manifest->size - 1, manifest->url);
+        err = ota_pull_receive(client, manifest->size - offset);
+    }
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+/**
+ * @brief Fetches the manifest and downloads and verifies the image, with retries
+ *
+ * @return OTA_PULL_STATE_UP_TO_DATE, OTA_PULL_STATE_DONE or OTA_PULL_STATE_FAILED
+ */
+static ota_pull_state_e ota_pull_run(void)
+{
+    bool has_manifest = false;
+    esp_err_t err = ESP_FAIL;
+
+    for (uint32_t attempt = 1; attempt <= OTA_PULL_ATTEMPTS; ++attempt)
+    {
+        if (attempt > 1)
+        {
+            vTaskDelay(pdMS_TO_TICKS(OTA_PULL_RETRY_DELAY_MS * (attempt - 1)));
+        }
+        if (!has_manifest)
+        {
+            ota_pull_set_state(OTA_PULL_STATE_MANIFEST);
+            err = ota_pull_fetch_manifest(&s_manifest);
+            if (err != ESP_OK)
+            {
+                ESP_LOGW(TAG, "manifest %s: %s, attempt %lu of %d", s_manifest_url, esp_err_to_name(err), attempt,
+                         OTA_PULL_ATTEMPTS);
+                continue;
+            }
+            has_manifest = true;
+
+            const char *running_version = esp_app_get_description()->version;
+            if (strcmp(s_manifest.version, running_version) == 0)
+            {
+                ESP_LOGI(TAG, "version %s is running already", running_version);
+                return OTA_PULL_STATE_UP_TO_DATE;
+            }
+            ESP_LOGI(TAG, "updating version %s to %s, %lu bytes", running_version, s_manifest.version,
+                     s_manifest.size);
+        }
+
+        ota_pull_set_state(OTA_PULL_STATE_DOWNLOAD);
+        err = ota_pull_download(&s_manifest);
+        if (err == ESP_OK)
+        {
+            break;
+        }
+        ESP_LOGW(TAG, "download: %s, image bytes in flash %lu, attempt %lu of %d", esp_err_to_name(err),
+                 ota_writer_get_written(), attempt, OTA_PULL_ATTEMPTS);
+    }
+    if (err != ESP_OK)
+    {
+        return OTA_PULL_STATE_FAILED;
+    }
+
+    err = ota_writer_commit();
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "image rejected: %s", esp_err_to_name(err));
+        return OTA_PULL_STATE_FAILED;
+    }
+    return OTA_PULL_STATE_DONE;
+}
+
+/**
+ * @brief Pull task, runs one pull and deletes itself
+ *
+ * @param pvParameters parameter which can be passed to the task
+ */
+static void ota_pull_task(void *pvParameters)
+{
+    ota_pull_state_e state = ota_pull_run();
+
+    ESP_LOGI(TAG, "pull of %s: %s", s_manifest_url, ota_pull_get_state_name(state));
+    ota_pull_set_state(state);
+    if (state != OTA_PULL_STATE_UP_TO_DATE)
+    {
+        /* Reported like the result of an upload, the server restarts into a new image */
+        app_state_set_fw_update_status(state == OTA_PULL_STATE_DONE ? OTA_UPDATE_SUCCESS : OTA_UPDATE_FAILED);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_running = false;
+    portEXIT_CRITICAL(&s_lock);
+    vTaskDelete(NULL);
+}
+
+esp_err_t ota_pull_start(const char *manifest_url)
+{
+    if (manifest_url != NULL && strlen(manifest_url) >= OTA_PULL_URL_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool busy = s_running;
+    s_running = true;
+    portEXIT_CRITICAL(&s_lock);
+    if (busy)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (manifest_url == NULL)
+    {
+        if (!app_nvs_load_ota_url(s_manifest_url, sizeof(s_manifest_url)))
+        {
+            s_running = false;
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    else if (strcmp(manifest_url, s_manifest_url) != 0)
+    {
+        strcpy(s_manifest_url, manifest_url);
+        app_nvs_save_ota_url(s_manifest_url);
+    }
+
+    s_state = OTA_PULL_STATE_MANIFEST;
+    if (xTaskCreatePinnedToCore(ota_pull_task, "ota_pull_task", OTA_PULL_TASK_STACK_SIZE, NULL,
+                                OTA_PULL_TASK_PRIORITY, NULL, OTA_PULL_TASK_CORE_ID) != pdPASS)
+    {
+        s_state = OTA_PULL_STATE_FAILED;
+        s_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+ota_pull_state_e ota_pull_get_state(void)
+{
+    return s_state;
+}
+
+const char *ota_pull_get_state_name(ota_pull_state_e state)
+{
+    switch (state)
+    {
+    case OTA_PULL_STATE_MANIFEST:
+        return "manifest";
+    case OTA_PULL_STATE_DOWNLOAD:
+        return "download";
+    case OTA_PULL_STATE_UP_TO_DATE:
+        return "up_to_date";
+    case OTA_PULL_STATE_DONE:
+        return "done";
+    case OTA_PULL_STATE_FAILED:
+        return "failed";
+    default:
+        return "idle";
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef OTA_PULL_H_
+#define OTA_PULL_H_
+
+#include "esp_err.h"
+
+/* Longest manifest and image URL */
+#define OTA_PULL_URL_SIZE 160
+/* Longest manifest, it is parsed in one piece */
+#define OTA_PULL_MANIFEST_SIZE 512
+/* Longest firmware version, the size of the version of esp_app_desc_t */
+#define OTA_PULL_VERSION_SIZE 32
+
+/* Connections per pull, a broken download continues where it stopped */
+#define OTA_PULL_ATTEMPTS 5
+/* Wait before the next attempt, grows with every failed one */
+#define OTA_PULL_RETRY_DELAY_MS 2000
+/* Network timeout of the manifest and image requests */
+#define OTA_PULL_TIMEOUT_MS 10000
+/* Receive buffer of the HTTP client, the image is read through it into the OTA writer slots */
+#define OTA_PULL_HTTP_BUFFER_SIZE 1536
+/* Period of the OTA progress pushed to /ws clients during a download */
+#define OTA_PULL_PUSH_PERIOD_MS 500
+
+/**
+ * @brief State of the running or the last pull
+ */
+typedef enum ota_pull_state
+{
+    OTA_PULL_STATE_IDLE = 0,   /* No pull since boot */
+    OTA_PULL_STATE_MANIFEST,   /* Fetching the manifest */
+    OTA_PULL_STATE_DOWNLOAD,   /* Streaming the image into the update partition */
+    OTA_PULL_STATE_UP_TO_DATE, /* Manifest names the running version, nothing was downloaded */
+    OTA_PULL_STATE_DONE,       /* Image verified, it is booted on the next restart */
+    OTA_PULL_STATE_FAILED,
+} ota_pull_state_e;
+
+/**
+ * @brief Starts a pull OTA update in its own task.
+ *
+ * @note The manifest is a JSON object {"version": "...", "url": "...", "size": n, "sha256": "..."}. The image URL
+ *       may be relative to the manifest URL. When the version differs from the running one, the image is streamed
+ *       through the OTA writer slots into the next update partition, so the memory used does not depend on the
+ *       image size. A broken download is resumed with a Range request. The image is booted after its SHA-256 is
+ *       verified, the same way as an upload to /OTAupdate.
+ *
+ * @param manifest_url manifest URL, it is saved to NVS for later pulls. NULL to use the saved one.
+ * @return
+ *      - ESP_OK: pull started
+ *      - ESP_ERR_INVALID_STATE: a pull is running
+ *      - ESP_ERR_NOT_FOUND: no URL given and none saved
+ *      - ESP_ERR_INVALID_SIZE: URL is longer than OTA_PULL_URL_SIZE
+ *      - ESP_ERR_NO_MEM: task could not be created
+ */
+esp_err_t ota_pull_start(const char *manifest_url);
+
+/**
+ * @brief Get the state of the running or the last pull
+ */
+ota_pull_state_e ota_pull_get_state(void);
+
+/**
+ * @brief Get the name of a pull state, as reported in the OTA status
+ */
+const char *ota_pull_get_state_name(ota_pull_state_e state);
+
+#endif /* OTA_PULL_H_ */
@@ -0,0 +1,415 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+
+#include "ota_writer.h"
+#include "tasks_common.h"
+
+/* Tag used for ESP serial console messages */
+static const char TAG[] = "ota_writer";
+
+/* First byte of an app image, ESP_IMAGE_HEADER_MAGIC */
+#define OTA_WRITER_IMAGE_MAGIC 0xE9
+
+/**
+ * @brief Filled slot waiting for the flash, data NULL ends the session
+ */
+typedef struct
+{
+    char *data;
+    size_t len;
+} ota_writer_slot_t;
+
+/**
+ * @brief Image being written, kept between sessions to resume it
+ */
+typedef struct
+{
+    const esp_partition_t *partition;
+    uint32_t size;                         /* 0 if unknown */
+    uint32_t written;                      /* Bytes in the flash and in the hash */
+    uint32_t erased_end;                   /* End of the erased blocks */
+    bool has_sha256;                       /* Expected hash is known */
+    bool resumable;                        /* A later session may continue the image */
+    uint8_t sha256[OTA_WRITER_SHA256_LEN]; /* Expected hash */
+    mbedtls_sha256_context sha_ctx;        /* Hash of the written bytes */
+} ota_writer_image_t;
+
+/* Writer task and its queues, created by the first session and kept for the next ones */
+static TaskHandle_t s_writer_task = NULL;
+static QueueHandle_t s_free_queue = NULL;
+static QueueHandle_t s_write_queue = NULL;
+static SemaphoreHandle_t s_done = NULL;
+
+/* Session state */
+static bool s_active = false;
+static char *s_slot_memory = NULL;
+static ota_writer_image_t s_image;
+static volatile esp_err_t s_err = ESP_OK; /* First failed write, later slots are returned unwritten */
+
+/* Statistics of the session, updated by the receiver and the writer task and read by status handlers */
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static ota_writer_stats_t s_stats;
+static int64_t s_start_us = 0;
+static int64_t s_network_wait_us = 0;
+static int64_t s_receive_stall_us = 0;
+static int64_t s_flash_write_us = 0;
+static int64_t s_window_start_us = 0;  /* Start of the receive rate window */
+static uint32_t s_window_received = 0; /* Bytes received when the window started */
+
+/**
+ * @brief Writes a slot behind the written part of the image, erases the block it reaches first
+ */
+static esp_err_t ota_writer_write(const char *data, size_t len)
+{
+    uint32_t end = s_image.written + len;
+    if (s_image.written == 0 && (uint8_t)data[0] != OTA_WRITER_IMAGE_MAGIC)
+    {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (end > s_image.partition->size || (s_image.size != 0 && end > s_image.size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (end > s_image.erased_end)
+    {
+        /* App partitions are block aligned, so the partition erase uses block erase commands */
+        uint32_t erase_end =
+            (end + OTA_WRITER_ERASE_BLOCK_SIZE - 1) / OTA_WRITER_ERASE_BLOCK_SIZE * OTA_WRITER_ERASE_BLOCK_SIZE;
+        if (erase_end > s_image.partition->size)
+        {
+            erase_end = s_image.partition->size;
+        }
+        esp_err_t err = esp_partition_erase_range(s_image.partition, s_image.erased_end,
+                                                  erase_end - s_image.erased_end);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        s_image.erased_end = erase_end;
+    }
+    esp_err_t err = esp_partition_write(s_image.partition, s_image.written, data, len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    mbedtls_sha256_update(&s_image.sha_ctx, (const unsigned char *)data, len);
+    s_image.written = end;
+    return ESP_OK;
+}
+
+/**
+ * @brief Flash writer task, writes the submitted slots in order and returns them to the free queue
+ */
+static void ota_writer_task(void *pvParameters)
+{
+    ota_writer_slot_t slot;
+    for (;;)
+    {
+        if (xQueueReceive(s_write_queue, &slot, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (slot.data == NULL)
+        {
+            xSemaphoreGive(s_done);
+            continue;
+        }
+
+        if (s_err == ESP_OK && slot.len > 0)
+        {
+            int64_t start_us = esp_timer_get_time();
+            esp_err_t err = ota_writer_write(slot.data, slot.len);
+            portENTER_CRITICAL(&s_stats_lock);
+            s_flash_write_us += esp_timer_get_time() - start_us;
+            s_stats.written = s_image.written;
+            portEXIT_CRITICAL(&s_stats_lock);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "write failed at image byte %lu: %s", s_image.written, esp_err_to_name(err));
+                s_err = err;
+            }
+        }
+        xQueueSend(s_free_queue, &slot.data, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Resume offset of the image kept from earlier sessions, regardless of a running session
+ */
+static uint32_t ota_writer_resume_offset(const uint8_t *sha256, uint32_t image_size)
+{
+    if (!s_image.resumable || s_image.size != image_size ||
+        memcmp(s_image.sha256, sha256, OTA_WRITER_SHA256_LEN) != 0 ||
+        s_image.partition != esp_ota_get_next_update_partition(NULL))
+    {
+        return 0;
+    }
+    return s_image.written;
+}
+
+uint32_t ota_writer_get_resume_offset(const uint8_t *sha256, uint32_t image_size)
+{
+    return s_active ? 0 : ota_writer_resume_offset(sha256, image_size);
+}
+
+/**
+ * @brief Prepares the session claimed by ota_writer_begin()
+ */
+static esp_err_t ota_writer_start(const uint8_t *sha256, uint32_t image_size, uint32_t offset, uint32_t total)
+{
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* The checks of esp_ota_begin(), which is bypassed to erase only what the image needs */
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t running_state;
+    if (partition == running)
+    {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+    if (esp_ota_get_state_partition(running, &running_state) == ESP_OK &&
+        running_state == ESP_OTA_IMG_PENDING_VERIFY)
+    {
+        /* Erasing the partition to roll back to would leave nothing to boot if the running app fails */
+        return ESP_ERR_OTA_ROLLBACK_INVALID_STATE;
+    }
+    if (image_size > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset != 0 && (sha256 == NULL || offset != ota_writer_resume_offset(sha256, image_size)))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_writer_task == NULL)
+    {
+        s_free_queue = xQueueCreate(OTA_WRITER_SLOT_COUNT, sizeof(char *));
+        /* One more entry than slots for the end marker */
+        s_write_queue = xQueueCreate(OTA_WRITER_SLOT_COUNT + 1, sizeof(ota_writer_slot_t));
+        s_done = xSemaphoreCreateBinary();
+        if (s_free_queue == NULL || s_write_queue == NULL || s_done == NULL ||
+            xTaskCreatePinnedToCore(ota_writer_task, "ota_writer_task", OTA_WRITER_TASK_STACK_SIZE, NULL,
+                                    OTA_WRITER_TASK_PRIORITY, &s_writer_task, OTA_WRITER_TASK_CORE_ID) != pdPASS)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    s_slot_memory = malloc(OTA_WRITER_SLOT_COUNT * OTA_WRITER_SLOT_SIZE);
+    if (s_slot_memory == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < OTA_WRITER_SLOT_COUNT; ++i)
+    {
+        char *slot = s_slot_memory + i * OTA_WRITER_SLOT_SIZE;
+        xQueueSend(s_free_queue, &slot, 0);
+    }
+
+    if (offset == 0)
+    {
+        /* New image, a resumable one it replaces is lost */
+        mbedtls_sha256_free(&s_image.sha_ctx);
+        memset(&s_image, 0, sizeof(s_image));
+        s_image.partition = partition;
+        s_image.size = image_size;
+        s_image.has_sha256 = sha256 != NULL;
+        if (sha256 != NULL)
+        {
+            memcpy(s_image.sha256, sha256, OTA_WRITER_SHA256_LEN);
+        }
+        mbedtls_sha256_init(&s_image.sha_ctx);
+        mbedtls_sha256_starts(&s_image.sha_ctx, 0);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "resuming image at byte %lu of %lu", offset, image_size);
+    }
+    s_image.resumable = false;
+    s_err = ESP_OK;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.active = true;
+    s_stats.total = total;
+    s_stats.written = s_image.written;
+    s_start_us = esp_timer_get_time();
+    s_window_start_us = s_start_us;
+    s_window_received = 0;
+    s_network_wait_us = 0;
+    s_receive_stall_us = 0;
+    s_flash_write_us = 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+esp_err_t ota_writer_begin(const uint8_t *sha256, uint32_t image_size, uint32_t offset, uint32_t total)
+{
+    /* Uploads begin in the httpd task and pulls in their own task, the session is claimed atomically */
+    portENTER_CRITICAL(&s_stats_lock);
+    bool busy = s_active;
+    s_active = true;
+    portEXIT_CRITICAL(&s_stats_lock);
+    if (busy)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ota_writer_start(sha256, image_size, offset, total);
+    if (err != ESP_OK)
+    {
+        s_active = false;
+    }
+    return err;
+}
+
+char *ota_writer_acquire(void)
+{
+    char *slot = NULL;
+    int64_t start_us = esp_timer_get_time();
+    xQueueReceive(s_free_queue, &slot, portMAX_DELAY);
+    int64_t stall_us = esp_timer_get_time() - start_us;
+    portENTER_CRITICAL(&s_stats_lock);
+    s_receive_stall_us += stall_us;
+    portEXIT_CRITICAL(&s_stats_lock);
+    if (s_err != ESP_OK)
+    {
+        xQueueSend(s_free_queue, &slot, 0);
+        return NULL;
+    }
+    return slot;
+}
+
+esp_err_t ota_writer_submit(char *slot, size_t len)
+{
+    ota_writer_slot_t msg = {.data = slot, .len = len};
+    xQueueSend(s_write_queue, &msg, portMAX_DELAY);
+    return s_err;
+}
+
+void ota_writer_add_received(size_t len, int64_t wait_us)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.received += len;
+    s_network_wait_us += wait_us;
+    if (now_us - s_window_start_us >= OTA_WRITER_RATE_WINDOW_MS * 1000)
+    {
+        s_stats.rate = (uint32_t)((s_stats.received - s_window_received) * 1000000LL / (now_us - s_window_start_us));
+        s_window_start_us = now_us;
+        s_window_received = s_stats.received;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+esp_err_t ota_writer_finish(void)
+{
+    if (!s_active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* The end marker is queued behind the submitted slots, so all of them are written once it is reached */
+    ota_writer_slot_t end = {.data = NULL, .len = 0};
+    xQueueSend(s_write_queue, &end, portMAX_DELAY);
+    xSemaphoreTake(s_done, portMAX_DELAY);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.elapsed_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+    s_stats.active = false;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    ota_writer_stats_t stats;
+    ota_writer_get_stats(&stats);
+    ESP_LOGI(TAG, "received %lu bytes in %lu ms, %lu B/s, wrote %lu bytes, network wait %lu ms, "
+                  "receive stall %lu ms, flash write %lu ms",
+             stats.received, stats.elapsed_ms, stats.average_rate, stats.written, stats.network_wait_ms,
+             stats.receive_stall_ms, stats.flash_write_ms);
+    xQueueReset(s_free_queue);
+    free(s_slot_memory);
+    s_slot_memory = NULL;
+    /* After a failed write the flash content behind the written part is unknown */
+    s_image.resumable = s_err == ESP_OK && s_image.has_sha256;
+    s_active = false;
+    return s_err;
+}
+
+uint32_t ota_writer_get_written(void)
+{
+    return s_image.written;
+}
+
+esp_err_t ota_writer_commit(void)
+{
+    if (s_active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_image.partition == NULL || s_image.written == 0 || (s_image.size != 0 && s_image.written != s_image.size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t sha256[OTA_WRITER_SHA256_LEN];
+    char hex[2 * OTA_WRITER_SHA256_LEN + 1];
+    mbedtls_sha256_finish(&s_image.sha_ctx, sha256);
+    s_image.resumable = false;
+    for (uint32_t i = 0; i < OTA_WRITER_SHA256_LEN; ++i)
+    {
+        sprintf(hex + 2 * i, "%02x", sha256[i]);
+    }
+    ESP_LOGI(TAG, "image of %lu bytes, sha256 %s", s_image.written, hex);
+
+    if (s_image.has_sha256 && memcmp(sha256, s_image.sha256, OTA_WRITER_SHA256_LEN) != 0)
+    {
+        ESP_LOGE(TAG, "sha256 differs from the expected one");
+        s_image.partition = NULL;
+        return ESP_ERR_INVALID_CRC;
+    }
+    /* The image is verified once more here, like esp_ota_end() would */
+    esp_err_t err = esp_ota_set_boot_partition(s_image.partition);
+    s_image.partition = NULL;
+    return err;
+}
+
+void ota_writer_get_stats(ota_writer_stats_t *stats)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    if (stats->active)
+    {
+        stats->elapsed_ms = (uint32_t)((now_us - s_start_us) / 1000);
+        /* Without receives the rate of the last window goes stale, the open window tells the current one */
+        if (now_us - s_window_start_us >= OTA_WRITER_RATE_WINDOW_MS * 1000)
+        {
+            stats->rate = (uint32_t)((stats->received - s_window_received) * 1000000LL / (now_us - s_window_start_us));
+        }
+    }
+    stats->network_wait_ms = (uint32_t)(s_network_wait_us / 1000);
+    stats->receive_stall_ms = (uint32_t)(s_receive_stall_us / 1000);
+    stats->flash_write_ms = (uint32_t)(s_flash_write_us / 1000);
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (stats->elapsed_ms > 0)
+    {
+        stats->average_rate = (uint32_t)((uint64_t)stats->received * 1000 / stats->elapsed_ms);
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef OTA_WRITER_H_
+#define OTA_WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Flash sector, the smallest unit of erase */
+#define OTA_WRITER_SECTOR_SIZE 4096
+/* Erase unit ahead of the writes, a 64 KiB block erases several times faster than its 16 sectors one by one */
+#define OTA_WRITER_ERASE_BLOCK_SIZE 0x10000
+/* One flash sector per slot, so a slot write erases at most one block */
+#define OTA_WRITER_SLOT_SIZE OTA_WRITER_SECTOR_SIZE
+/* Slots of the ring, one being filled by the receiver while the others wait for or are in the flash write */
+#define OTA_WRITER_SLOT_COUNT 3
+
+/* Length of the image hash */
+#define OTA_WRITER_SHA256_LEN 32
+
+/* Window of the current receive rate */
+#define OTA_WRITER_RATE_WINDOW_MS 1000
+
+/**
+ * @brief Progress and timing of the running or the last OTA session
+ */
+typedef struct
+{
+    bool active;               /* A session is running */
+    uint32_t total;            /* Bytes expected from the network, 0 if unknown */
+    uint32_t received;         /* Bytes received from the network */
+    uint32_t written;          /* Image bytes in the flash, including the ones of resumed sessions */
+    uint32_t network_wait_ms;  /* Receiver waited for the network */
+    uint32_t receive_stall_ms; /* Receiver waited for a free slot, the flash was slower than the network */
+    uint32_t flash_write_ms;   /* Flash writer busy erasing and writing */
+    uint32_t elapsed_ms;       /* Since the session started, until it finished */
+    uint32_t rate;             /* Bytes/s received in the last OTA_WRITER_RATE_WINDOW_MS */
+    uint32_t average_rate;     /* Bytes/s received since the session started */
+} ota_writer_stats_t;
+
+/**
+ * @brief Starts a pipelined OTA write session into the next update partition.
+ *
+ * @note The receiver fills slots taken with ota_writer_acquire() and hands them to ota_writer_submit(). The flash
+ *       writer task erases the blocks the image reaches and writes the slots on the other core, so the network
+ *       receive continues while the flash is busy, and only the blocks the image needs are erased. The SHA-256
+ *       of the image is computed while writing.
+ *
+ *       An image with a hash can be written in several sessions: when a session ends early the written part is
+ *       kept, and a later session of the same image continues at ota_writer_get_resume_offset(). The resume state
+ *       is kept in RAM until a reboot. Only one session runs at a time.
+ *
+ * @param sha256 expected SHA-256 of the image, NULL if unknown. The image can not be resumed then.
+ * @param image_size image size, 0 if unknown
+ * @param offset image offset of the first byte, 0 or the resume offset of the image
+ * @param total bytes expected from the network for the progress, 0 if unknown
+ * @return
+ *      - ESP_OK: session started
+ *      - ESP_ERR_INVALID_STATE: a session is running
+ *      - ESP_ERR_NOT_FOUND: no update partition
+ *      - ESP_ERR_OTA_PARTITION_CONFLICT: the update partition is the running one
+ *      - ESP_ERR_OTA_ROLLBACK_INVALID_STATE: the running app is not confirmed yet, its rollback partition is kept
+ *      - ESP_ERR_INVALID_SIZE: image does not fit the partition
+ *      - ESP_ERR_INVALID_ARG: offset is not the resume offset of the image
+ *      - ESP_ERR_NO_MEM: slots or the writer task could not be allocated
+ */
+esp_err_t ota_writer_begin(const uint8_t *sha256, uint32_t image_size, uint32_t offset, uint32_t total);
+
+/**
+ * @brief Get the offset an interrupted upload of the image continues at
+ *
+ * @param sha256 SHA-256 of the image
+ * @param image_size image size
+ * @return bytes of the image already in the flash, 0 if the image has to start from the beginning
+ */
+uint32_t ota_writer_get_resume_offset(const uint8_t *sha256, uint32_t image_size);
+
+/**
+ * @brief Takes a free slot, blocks while all slots wait for the flash
+ *
+ * @return slot of OTA_WRITER_SLOT_SIZE bytes, NULL if a flash write failed
+ */
+char *ota_writer_acquire(void);
+
+/**
+ * @brief Hands a filled slot to the flash writer task
+ *
+ * @param slot slot of ota_writer_acquire()
+ * @param len number of bytes to write, 0 returns the slot unwritten
+ * @return ESP_OK, otherwise the error of a failed flash write
+ */
+esp_err_t ota_writer_submit(char *slot, size_t len);
+
+/**
+ * @brief Counts bytes received from the network
+ *
+ * @param len number of bytes
+ * @param wait_us time the receiver waited for them
+ */
+void ota_writer_add_received(size_t len, int64_t wait_us);
+
+/**
+ * @brief Waits until all submitted slots are written and ends the session
+ *
+ * @note Without a write error, an image with a hash stays resumable until ota_writer_commit().
+ *
+ * @return
+ *      - ESP_OK: all slots written
+ *      - ESP_ERR_OTA_VALIDATE_FAILED: data does not start with an app image header
+ *      - ESP_ERR_INVALID_SIZE: data is longer than the image or the partition
+ *      - other: error of the flash erase or write
+ */
+esp_err_t ota_writer_finish(void);
+
+/**
+ * @brief Get image bytes in the flash, the resume offset of the last session
+ */
+uint32_t ota_writer_get_written(void);
+
+/**
+ * @brief Verifies the image of the finished sessions and makes it the boot partition
+ *
+ * @return
+ *      - ESP_OK: image is booted on the next restart
+ *      - ESP_ERR_INVALID_STATE: a session is running
+ *      - ESP_ERR_INVALID_SIZE: image is incomplete, it stays resumable
+ *      - ESP_ERR_INVALID_CRC: SHA-256 of the written image differs from the expected one
+ *      - other: error of esp_ota_set_boot_partition(), e.g. the image is not valid
+ */
+esp_err_t ota_writer_commit(void);
+
+/**
+ * @brief Get progress and timing of the running or the last OTA session
+ *
+ * @param stats pointer where statistics are copied
+ */
+void ota_writer_get_stats(ota_writer_stats_t *stats);
+
+#endif /* OTA_WRITER_H_ */
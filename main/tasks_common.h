@@ -6,14 +6,52 @@
 #define WIFI_APP_TASK_PRIORITY 5
 #define WIFI_APP_TASK_CORE_ID 0
 
+/* Wi-Fi PMK task, created per new access point to derive the PMK of the fast connect cache. Lowest priority on the
+ * core which is not used by the WiFi stack, the 4096 PBKDF2 rounds take long and nothing waits for them */
+#define WIFI_APP_PMK_TASK_STACK_SIZE 4096
+#define WIFI_APP_PMK_TASK_PRIORITY 1
+#define WIFI_APP_PMK_TASK_CORE_ID 1
+
 /*HTTP server task*/
 #define HTTP_SERVER_TASK_SIZE 8192
 #define HTTP_SERVER_TASK_PRIORITY 4
 #define HTTP_SERVER_TASK_CODE_ID 0
 
-/*HTTP server monitor task*/
-#define HTTP_SERVER_MONITOR_SIZE 4096
-#define HTTP_SERVER_MONITOR_PRIORITY 3
-#define HTTP_SERVER_MONITOR_CORE_ID 0
+/*HTTP server asset workers, stream large static assets so one slow client does not hold the httpd task*/
+#define HTTP_SERVER_ASSET_WORKERS 3
+#define HTTP_SERVER_ASSET_WORKER_SIZE 3072
+#define HTTP_SERVER_ASSET_WORKER_PRIORITY 4
+#define HTTP_SERVER_ASSET_WORKER_CORE_ID 0
+
+/* Application state task, notifies the state subscribers such as the /ws push */
+#define APP_STATE_TASK_STACK_SIZE 3072
+#define APP_STATE_TASK_PRIORITY 3
+#define APP_STATE_TASK_CORE_ID 0
+
+/* Lamp save task, writes the lamp state to NVS once it settles. Lowest priority, nothing waits for the save */
+#define LAMP_SAVE_TASK_STACK_SIZE 3072
+#define LAMP_SAVE_TASK_PRIORITY 1
+#define LAMP_SAVE_TASK_CORE_ID 0
+
+/* OTA flash writer task, writes received firmware on the core which is not used by the WiFi stack and httpd.
+ * Below the render task, so a flash write does not delay a frame */
+#define OTA_WRITER_TASK_STACK_SIZE 3072
+#define OTA_WRITER_TASK_PRIORITY 5
+#define OTA_WRITER_TASK_CORE_ID 1
+
+/* OTA pull task, created per pull. Below the flash writer, it only waits for the network and for free slots */
+#define OTA_PULL_TASK_STACK_SIZE 4096
+#define OTA_PULL_TASK_PRIORITY 4
+#define OTA_PULL_TASK_CORE_ID 0
+
+/* WS2812 render task, pinned to the core which is not used by the WiFi stack */
+#define WS2812_RENDER_TASK_STACK_SIZE 4096
+#define WS2812_RENDER_TASK_PRIORITY 6
+#define WS2812_RENDER_TASK_CORE_ID 1
+
+/* WS2812 transmit tasks, one per channel. Preempt the render task to start a transmission right away */
+#define WS2812_TX_TASK_STACK_SIZE 2048
+#define WS2812_TX_TASK_PRIORITY 7
+#define WS2812_TX_TASK_CORE_ID 1
 
 #endif /* TASKS_COMMON_H_ */
@@ -0,0 +1,25 @@
+#ifndef WEB_ASSETS_H_
+#define WEB_ASSETS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Embedded static asset of the web page, the table is generated by tools/gen_web_assets.py
+ */
+typedef struct
+{
+    const char *path;          /* Request path, index.html is served at "/" */
+    const char *mime;          /* Content-Type */
+    const uint8_t *data;       /* Encoded content */
+    size_t len;                /* Length of the encoded content */
+    const char *etag;          /* Strong ETag, quoted hash of the encoded content */
+    const char *encoding;      /* Content-Encoding */
+    const char *cache_control; /* Cache-Control */
+} web_asset_t;
+
+/* Assets listed in WEB_PAGE_ASSETS of main/CMakeLists.txt */
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+
+#endif /* WEB_ASSETS_H_ */
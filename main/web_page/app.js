@@ -4,6 +4,8 @@
 var seconds = null;
 var otaTimerVar = null;
 var wifiConnectInterval = null;
+var stateSocket = null;
+var lampState = null;
 
 /**
  * Initialize functions here.
@@ -11,6 +13,7 @@ var wifiConnectInterval = null;
 $(document).ready(function () {
     getSSID();
     getUpdateStatus();
+    openStateSocket();
     // startDHTSensorInterval();
     startLocalTimeInterval();
     getConnectInfo();
@@ -63,7 +66,11 @@ function updateFirmware() {
  */
 function updateProgress(oEvent) {
     if (oEvent.lengthComputable) {
-        getUpdateStatus();
+        // The result and the device side progress are pushed through /ws, without it show the browser side
+        if (!isStateSocketOpen()) {
+            showUploadProgress(oEvent.loaded, oEvent.total);
+            getUpdateStatus();
+        }
     }
     else {
         window.alert('total size is unknown')
@@ -80,21 +87,58 @@ function getUpdateStatus() {
     xhr.send('ota_update_status');
 
     if (xhr.readyState == 4 && xhr.status == 200) {
-        var response = JSON.parse(xhr.responseText);
+        showUpdateStatus(JSON.parse(xhr.responseText));
+    }
+}
 
-        document.getElementById("latest_firmware").innerHTML = response.compile_date + " - " + response.compile_time
+/**
+ * Displays the upload progress bar.
+ */
+function showUploadProgress(done, total) {
+    var bar = document.getElementById("ota_progress");
+    bar.style.display = "";
+    bar.value = total > 0 ? Math.floor(done * 100 / total) : 0;
+}
 
-        // If flashing was complete it will return a 1, else -1
-        // A return of 0 is just for information on the Latest Firmware request
-        if (response.ota_update_status == 1) {
-            // Set the countdown timer time
+/**
+ * Displays the upload progress measured by the device: received and flashed bytes, current and average rate.
+ */
+function showDeviceProgress(progress) {
+    if (!progress || (!progress.active && progress.received == 0)) {
+        return;
+    }
+    showUploadProgress(progress.received, progress.total);
+    document.getElementById("ota_progress_info").innerHTML =
+        Math.floor(progress.received / 1024) + " of " + Math.floor(progress.total / 1024) + " KB received, " +
+        Math.floor(progress.written / 1024) + " KB written, " +
+        (progress.active ? (progress.rate / 1024).toFixed(1) + " KB/s now, " : "") +
+        (progress.average_rate / 1024).toFixed(1) + " KB/s average (network wait " + progress.network_wait_ms +
+        " ms, flash stall " + progress.receive_stall_ms + " ms)";
+}
+
+/**
+ * Displays the firmware update status, received from /OTAstatus or pushed through /ws.
+ */
+function showUpdateStatus(response) {
+    document.getElementById("latest_firmware").innerHTML = response.compile_date + " - " + response.compile_time
+    showDeviceProgress(response.progress);
+
+    // If flashing was complete it will return a 1, else -1
+    // A return of 0 is just for information on the Latest Firmware request
+    if (response.ota_update_status == 1) {
+        // Start the countdown timer once
+        if (otaTimerVar == null) {
             seconds = 10;
-            // Start the countdown timer
             otaRebootTimer();
         }
-        else if (response.ota_update_status == -1) {
-            document.getElementById("ota_update_status").innerHTML = "!!! Upload Error !!!";
-        }
+    }
+    else if (response.ota_update_status == -1) {
+        document.getElementById("ota_update_status").innerHTML = "!!! Upload Error !!!";
+    }
+    // 2: a raw upload broke off or sent a range, it continues at resume_offset
+    else if (response.ota_update_status == 2) {
+        document.getElementById("ota_update_status").innerHTML = "Upload incomplete, " + response.resume_offset +
+            " bytes in flash, resume the upload to continue";
     }
 }
 
@@ -154,27 +198,71 @@ function getWifiConnectStatus() {
     // })
     
     if (xhr.readyState == 4 && xhr.status == 200) {
-        var response = JSON.parse(xhr.responseText);
+        showWifiConnectStatus(JSON.parse(xhr.responseText));
+    }
+}
 
+/**
+ * Displays the WiFi connection status, received from /wifiConnectStatus or pushed through /ws.
+ */
+function showWifiConnectStatus(response) {
+    if (response.wifi_connect_status == 1) {
         document.getElementById("wifi_connect_status").innerHTML = "Connecting...";
-
-        if (response.wifi_connect_status == 2) {
-            document.getElementById("wifi_connect_status").innerHTML = "<h4 class='rd'>Failed to Connect. Please check your AP credentials and compatibility</h4>";
-            stopWifiConnectStatusInterval();
-        }
-        else if (response.wifi_connect_status == 3) {
-            document.getElementById("wifi_connect_status").innerHTML = "<h4 class='gr'>Connection Success!</h4>";
-            stopWifiConnectStatusInterval();
-            getConnectInfo();
-        }
+    }
+    else if (response.wifi_connect_status == 2) {
+        document.getElementById("wifi_connect_status").innerHTML = "<h4 class='rd'>Failed to Connect. Please check your AP credentials and compatibility</h4>";
+        stopWifiConnectStatusInterval();
+    }
+    else if (response.wifi_connect_status == 3) {
+        document.getElementById("wifi_connect_status").innerHTML = "<h4 class='gr'>Connection Success!</h4>";
+        stopWifiConnectStatusInterval();
+        getConnectInfo();
     }
 }
 
 /**
- * Starts the interval for checking the connection status.
+ * Starts the interval for checking the connection status, only if the status is not pushed through /ws.
  */
 function startWifiConnectStatusInterval() {
-    wifiConnectInterval = setInterval(getWifiConnectStatus, 5000);
+    if (!isStateSocketOpen() && wifiConnectInterval == null) {
+        wifiConnectInterval = setInterval(getWifiConnectStatus, 5000);
+    }
+}
+
+/**
+ * Checks whether the state is pushed by the server.
+ */
+function isStateSocketOpen() {
+    return stateSocket != null && stateSocket.readyState == WebSocket.OPEN;
+}
+
+/**
+ * Subscribes to WiFi, OTA and lamp state pushed by the server, reconnects when the connection is lost.
+ */
+function openStateSocket() {
+    if (!("WebSocket" in window)) {
+        return;
+    }
+    stateSocket = new WebSocket("ws://" + window.location.host + "/ws");
+    stateSocket.onmessage = function (event) {
+        var state = JSON.parse(event.data);
+        if (state.type == "wifi") {
+            showWifiConnectStatus(state);
+        }
+        else if (state.type == "ota") {
+            showUpdateStatus(state);
+        }
+        else if (state.type == "lamp") {
+            lampState = state;
+        }
+    };
+    stateSocket.onopen = function () {
+        stopWifiConnectStatusInterval();
+    };
+    stateSocket.onclose = function () {
+        stateSocket = null;
+        setTimeout(openStateSocket, 2000);
+    };
 }
 
 /**
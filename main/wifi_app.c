@@ -4,9 +4,14 @@
 
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "lwip/netdb.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
 
 #include "app_nvs.h"
+#include "app_state.h"
+#include "boot_profile.h"
 #include "http_server.h"
 #include "tasks_common.h"
 #include "wifi_app.h"
@@ -28,6 +33,26 @@ esp_netif_t *esp_netif_ap = NULL;
 /* Numbers of WiFI STA connecting tries */
 static int g_retry_number;
 
+/* Station is configured for the cached access point, a disconnect falls back to a connect with scan */
+static volatile bool g_sta_fast_config = false;
+
+/* Start and kind of the running station connect, for the time to IP */
+static int64_t g_connect_start_us = 0;
+static const char *g_connect_path = "scan";
+
+/**
+ * @brief Fast connect entry of a new connection, owned by the PMK task until it saved the entry
+ */
+typedef struct
+{
+    app_nvs_sta_fast_connect_t fast;
+    wifi_sta_config_t sta; /* Credentials the PMK is derived from */
+} wifi_app_pmk_job_t;
+
+static portMUX_TYPE g_pmk_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool g_pmk_running = false;
+static wifi_app_pmk_job_t g_pmk_job;
+
 /* WiFi application event group handle and status bits */
 static EventGroupHandle_t wifi_app_event_group;
 const int WIFI_APP_MSG_STA_LOAD_SAVED_CREDENTIALS_BIT = BIT0;
@@ -79,10 +104,15 @@ static void wifi_wifi_app_event_group(void *arg, esp_event_base_t event_base, in
                 wifi_app_send_message(WIFI_APP_MSG_STA_DISCONNECTED);
                 break;
             }
+            if (g_sta_fast_config)
+            {
+                /* Cached access point did not answer or is gone, retries go through a scan */
+                g_sta_fast_config = false;
+                wifi_app_send_message(WIFI_APP_MSG_STA_FAST_CONNECT_FAILED);
+                break;
+            }
 
-            wifi_event_sta_disconnected_t *wifi_event_sta_disconnected =
-                (wifi_event_sta_disconnected_t *)malloc(sizeof(wifi_event_sta_disconnected_t));
-            *wifi_event_sta_disconnected = *((wifi_event_sta_disconnected_t *)event_data);
+            wifi_event_sta_disconnected_t *wifi_event_sta_disconnected = (wifi_event_sta_disconnected_t *)event_data;
             printf("WIFI_EVENT_AP_STA_DISCONNECTED, reason_code %d\n", wifi_event_sta_disconnected->reason);
             esp_wifi_connect();
             ++g_retry_number;
@@ -196,10 +226,173 @@ static void wifi_app_soft_ap_config()
  */
 static void wifi_app_connect_sta()
 {
+    g_sta_fast_config = false;
+    g_connect_start_us = esp_timer_get_time();
+    g_connect_path = "scan";
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, wifi_app_get_wifi_config()));
     ESP_ERROR_CHECK(esp_wifi_connect());
 }
 
+/**
+ * @brief Connect the ESP32 to the access point of the last connection, on its channel and without deriving the PMK.
+ *
+ * @note The full scan of all channels and the PBKDF2 of the password are the slow steps of a cold connect. With the
+ *       BSSID and the channel set, the driver probes only that channel, and a 64 hex digit password is taken as the
+ *       PSK itself.
+ *
+ * @return true if an access point was cached and the connect started, otherwise false
+ */
+static bool wifi_app_fast_connect_sta()
+{
+    app_nvs_sta_fast_connect_t fast;
+    if (!app_nvs_load_sta_fast_connect(&fast))
+    {
+        return false;
+    }
+
+    wifi_config_t config = *wifi_app_get_wifi_config();
+    memcpy(config.sta.bssid, fast.bssid, sizeof(config.sta.bssid));
+    config.sta.bssid_set = true;
+    config.sta.channel = fast.channel;
+    if (fast.has_pmk)
+    {
+        static const char hex[] = "0123456789abcdef";
+        for (uint32_t i = 0; i < APP_NVS_PMK_LEN; ++i)
+        {
+            config.sta.password[2 * i] = hex[fast.pmk[i] >> 4];
+            config.sta.password[2 * i + 1] = hex[fast.pmk[i] & 0x0f];
+        }
+    }
+
+    ESP_LOGI(TAG, "fast connect to %02x:%02x:%02x:%02x:%02x:%02x on channel %u%s", fast.bssid[0], fast.bssid[1],
+             fast.bssid[2], fast.bssid[3], fast.bssid[4], fast.bssid[5], fast.channel,
+             fast.has_pmk ? " with cached PMK" : "");
+    g_sta_fast_config = true;
+    g_connect_start_us = esp_timer_get_time();
+    g_connect_path = "fast connect";
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &config));
+    ESP_ERROR_CHECK(esp_wifi_connect());
+    return true;
+}
+
+/**
+ * @brief Derives the WPA2 PMK of the station credentials, PBKDF2-HMAC-SHA1 of the password salted with the SSID
+ *
+ * @param sta station configuration
+ * @param pmk pointer where the APP_NVS_PMK_LEN bytes of the PMK are stored
+ * @return true on success, false for an open network or a password which is the PSK already
+ */
+static bool wifi_app_derive_pmk(const wifi_sta_config_t *sta, uint8_t *pmk)
+{
+    size_t ssid_len = strnlen((const char *)sta->ssid, sizeof(sta->ssid));
+    size_t password_len = strnlen((const char *)sta->password, sizeof(sta->password));
+    if (password_len < 8 || password_len == sizeof(sta->password))
+    {
+        return false;
+    }
+
+    mbedtls_md_context_t md;
+    mbedtls_md_init(&md);
+    int ret = mbedtls_md_setup(&md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+    if (ret == 0)
+    {
+        ret = mbedtls_pkcs5_pbkdf2_hmac(&md, sta->password, password_len, sta->ssid, ssid_len, 4096,
+                                        APP_NVS_PMK_LEN, pmk);
+    }
+    mbedtls_md_free(&md);
+    return ret == 0;
+}
+
+/**
+ * @brief Saves the access point for the next fast connect if it differs from the saved one
+ */
+static void wifi_app_save_fast_connect(const app_nvs_sta_fast_connect_t *fast)
+{
+    app_nvs_sta_fast_connect_t cached;
+    if (!app_nvs_load_sta_fast_connect(&cached) || memcmp(&cached, fast, sizeof(cached)) != 0)
+    {
+        app_nvs_save_sta_fast_connect(fast);
+    }
+}
+
+/**
+ * @brief PMK task, derives the PMK of the job, saves its fast connect entry and deletes itself
+ *
+ * @param pvParameters parameter which can be passed to the task
+ */
+static void wifi_app_pmk_task(void *pvParameters)
+{
+    int64_t start_us = esp_timer_get_time();
+    g_pmk_job.fast.has_pmk = wifi_app_derive_pmk(&g_pmk_job.sta, g_pmk_job.fast.pmk);
+    ESP_LOGI(TAG, "PMK %s in %lld ms", g_pmk_job.fast.has_pmk ? "derived" : "not derived",
+             (esp_timer_get_time() - start_us) / 1000);
+    wifi_app_save_fast_connect(&g_pmk_job.fast);
+    memset(&g_pmk_job, 0, sizeof(g_pmk_job));
+
+    portENTER_CRITICAL(&g_pmk_lock);
+    g_pmk_running = false;
+    portEXIT_CRITICAL(&g_pmk_lock);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Logs the time to IP and caches the access point of the new connection for the next fast connect
+ *
+ * @note The PMK of a PSK network is derived by the PMK task, the 4096 PBKDF2 rounds would otherwise hold up the
+ *       Wi-Fi application task. A connection while the task runs leaves the cache to the next connection.
+ */
+static void wifi_app_sta_connected()
+{
+    int64_t now_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "time to IP: %lld ms with %s, %lld ms since boot", (now_us - g_connect_start_us) / 1000,
+             g_connect_path, now_us / 1000);
+
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+    {
+        return;
+    }
+    app_nvs_sta_fast_connect_t cached;
+    bool has_cached = app_nvs_load_sta_fast_connect(&cached);
+    if (g_sta_fast_config && has_cached)
+    {
+        /* The cached access point answered, so its entry is still right */
+        return;
+    }
+
+    app_nvs_sta_fast_connect_t fast;
+    memset(&fast, 0, sizeof(fast));
+    memcpy(fast.bssid, ap.bssid, sizeof(fast.bssid));
+    fast.channel = ap.primary;
+    /* The PSK works with WPA/WPA2 personal and the WPA2 side of WPA3 transition networks */
+    if (ap.authmode == WIFI_AUTH_WPA_PSK || ap.authmode == WIFI_AUTH_WPA2_PSK ||
+        ap.authmode == WIFI_AUTH_WPA_WPA2_PSK || ap.authmode == WIFI_AUTH_WPA2_WPA3_PSK)
+    {
+        portENTER_CRITICAL(&g_pmk_lock);
+        bool running = g_pmk_running;
+        g_pmk_running = true;
+        portEXIT_CRITICAL(&g_pmk_lock);
+        if (running)
+        {
+            return;
+        }
+
+        g_pmk_job.fast = fast;
+        g_pmk_job.sta = wifi_app_get_wifi_config()->sta;
+        if (xTaskCreatePinnedToCore(wifi_app_pmk_task, "wifi_app_pmk_task", WIFI_APP_PMK_TASK_STACK_SIZE, NULL,
+                                    WIFI_APP_PMK_TASK_PRIORITY, NULL, WIFI_APP_PMK_TASK_CORE_ID) == pdPASS)
+        {
+            return;
+        }
+        /* Without the task the entry is saved without PMK, the driver derives it on the fast connect */
+        memset(&g_pmk_job, 0, sizeof(g_pmk_job));
+        portENTER_CRITICAL(&g_pmk_lock);
+        g_pmk_running = false;
+        portEXIT_CRITICAL(&g_pmk_lock);
+    }
+    wifi_app_save_fast_connect(&fast);
+}
+
 /**
  * @brief Main task for the WIFI application
  *
@@ -207,19 +400,27 @@ static void wifi_app_connect_sta()
  */
 static void wifi_app_task(void *pvParameters)
 {
-    led_strip_handle_t led_strip = (led_strip_handle_t)pvParameters;
-
     wifi_app_queue_message_t msg;
     EventBits_t eventBits;
 
+    boot_profile_begin(BOOT_PHASE_WIFI_INIT);
     wifi_wifi_app_event_group_init();
 
     wifi_app_default_wifi_init();
 
     wifi_app_soft_ap_config();
+    boot_profile_end(BOOT_PHASE_WIFI_INIT);
+
+    // The server only needs the TCP stack initialized above, started here it listens as soon as the SoftAP is up
+    // instead of waiting for esp_wifi_start() and the station credentials
+    boot_profile_begin(BOOT_PHASE_HTTP_SERVER);
+    http_server_start();
+    boot_profile_end(BOOT_PHASE_HTTP_SERVER);
 
     // Start WIFI
+    boot_profile_begin(BOOT_PHASE_WIFI_START);
     ESP_ERROR_CHECK(esp_wifi_start());
+    boot_profile_end(BOOT_PHASE_WIFI_START);
 
     // Send first event message
     wifi_app_send_message(WIFI_APP_MSG_STA_LOAD_SAVED_CREDENTIALS);
@@ -235,21 +436,19 @@ static void wifi_app_task(void *pvParameters)
                 if (app_nvs_load_sta_creds())
                 {
                     ESP_LOGI(TAG, "Loading station configuration");
-                    wifi_app_connect_sta();
+                    boot_profile_begin(BOOT_PHASE_STA_CONNECT);
+                    if (!wifi_app_fast_connect_sta())
+                    {
+                        wifi_app_connect_sta();
+                    }
                     xEventGroupSetBits(wifi_app_event_group, WIFI_APP_MSG_STA_LOAD_SAVED_CREDENTIALS_BIT);
                 }
                 else
                 {
                     ESP_LOGI(TAG, "Unable to load station configuration");
+                    /* Nothing to connect to, the lamp asks for the configuration through the SoftAP */
+                    enable_light_color(color_RED);
                 }
-                wifi_app_send_message(WIFI_APP_MSG_START_HTTP_SERVER);
-
-                break;
-
-            case WIFI_APP_MSG_START_HTTP_SERVER:
-                ESP_LOGI(TAG, "WIFI_APP_MSG_START_HTTP_SERVER");
-                http_server_start();
-                enable_light_color(led_strip, color_RED);
                 break;
 
             case WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER:
@@ -257,19 +456,36 @@ static void wifi_app_task(void *pvParameters)
 
                 xEventGroupSetBits(wifi_app_event_group, WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER_BIT);
 
-                enable_light_color(led_strip, color_BLUE);
+                enable_light_color(color_BLUE);
                 wifi_app_connect_sta();
                 g_retry_number = 0;
-                http_server_monitor_send_message(HTTP_MSG_WIFI_CONNECT_INIT);
+                app_state_set_wifi_connect_status(APP_WIFI_STATUS_CONNECTING);
 
                 break;
 
+            case WIFI_APP_MSG_STA_FAST_CONNECT_FAILED: {
+                ESP_LOGI(TAG, "WIFI_APP_MSG_STA_FAST_CONNECT_FAILED");
+                /* The time to IP includes the failed fast attempt */
+                int64_t connect_start_us = g_connect_start_us;
+                g_retry_number = 0;
+                wifi_app_connect_sta();
+                g_connect_start_us = connect_start_us;
+                g_connect_path = "scan after fast connect";
+            }
+            break;
+
             case WIFI_APP_MSG_STA_CONNECTED_GOT_IP:
                 ESP_LOGI(TAG, "WIFI_APP_MSG_STA_CONNECTED_GOT_IP");
-                enable_light_color(led_strip, color_WARM_WHITE);
-                http_server_monitor_send_message(HTTP_MSG_WIFI_CONNECT_SUCCESS);
+                wifi_app_sta_connected();
+                boot_profile_end(BOOT_PHASE_STA_CONNECT);
+                app_state_set_wifi_connect_status(APP_WIFI_STATUS_CONNECT_SUCCESS);
 
                 eventBits = xEventGroupGetBits(wifi_app_event_group);
+                /* The restored lamp state is kept on a reconnect with the saved credentials */
+                if (eventBits & WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER_BIT)
+                {
+                    enable_light_color(color_WARM_WHITE);
+                }
                 /* Save credentials only when connecting from HTTP server */
                 if (eventBits & WIFI_APP_MSG_STA_LOAD_SAVED_CREDENTIALS_BIT)
                 {
@@ -299,13 +515,13 @@ static void wifi_app_task(void *pvParameters)
                 else if (eventBits & WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER_BIT)
                 {
                     xEventGroupClearBits(wifi_app_event_group, WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER_BIT);
-                    http_server_monitor_send_message(WIFI_REASON_CONNECTION_FAIL);
+                    app_state_set_wifi_connect_status(APP_WIFI_STATUS_CONNECT_FAIL);
                 }
                 else if (eventBits & WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT_BIT)
                 {
                     ESP_LOGI(TAG, "WIFI_APP_MSG_STA_DISCONNECTED: USER DISCONNECTION");
                     xEventGroupClearBits(wifi_app_event_group, WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT_BIT);
-                    http_server_monitor_send_message(HTTP_MSG_WIFI_USER_DISCONNECT);
+                    app_state_set_wifi_connect_status(APP_WIFI_STATUS_DISCONNECTED);
                 }
                 else
                 {
@@ -324,7 +540,7 @@ static void wifi_app_task(void *pvParameters)
                 break;
 
             default:
-                disable_light(led_strip);
+                disable_light();
                 break;
             }
         }
@@ -342,7 +558,7 @@ wifi_config_t *wifi_app_get_wifi_config()
     return wifi_config;
 }
 
-void wifi_app_start(led_strip_handle_t led_strip)
+void wifi_app_start()
 {
     ESP_LOGI(TAG, "Starting wifi application");
     esp_log_level_set("wifi", ESP_LOG_NONE);
@@ -354,6 +570,6 @@ void wifi_app_start(led_strip_handle_t led_strip)
     wifi_app_queue_handle = xQueueCreate(queue_length, sizeof(wifi_app_queue_message_t));
 
     wifi_app_event_group = xEventGroupCreate();
-    xTaskCreatePinnedToCore(wifi_app_task, "wifi_app_task", WIFI_APP_TASK_STACK_SIZE, (void *)led_strip,
-                            WIFI_APP_TASK_PRIORITY, NULL, WIFI_APP_TASK_CORE_ID);
+    xTaskCreatePinnedToCore(wifi_app_task, "wifi_app_task", WIFI_APP_TASK_STACK_SIZE, NULL, WIFI_APP_TASK_PRIORITY,
+                            NULL, WIFI_APP_TASK_CORE_ID);
 }
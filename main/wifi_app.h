@@ -5,7 +5,6 @@
 
 #include "esp_netif.h"
 #include "esp_wifi.h"
-#include "led_strip.h"
 
 #define WIFI_AP_SSID "ESP32_AP"
 #define WIFI_AP_PASSWORD "password"
@@ -30,12 +29,12 @@ extern esp_netif_t *esp_netif_ap;
  */
 typedef enum
 {
-    WIFI_APP_MSG_START_HTTP_SERVER = 0,
-    WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER,
+    WIFI_APP_MSG_CONNECTING_FROM_HTTP_SERVER = 0,
     WIFI_APP_MSG_STA_CONNECTED_GOT_IP,
     WIFI_APP_MSG_STA_LOAD_SAVED_CREDENTIALS,
     WIFI_APP_MSG_USER_REQUESTED_STA_DISCONNECT,
     WIFI_APP_MSG_STA_DISCONNECTED,
+    WIFI_APP_MSG_STA_FAST_CONNECT_FAILED,
 } wifi_app_message_e;
 
 /**
@@ -57,7 +56,7 @@ BaseType_t wifi_app_send_message(wifi_app_message_e messageID);
 /**
  * @brief Starts thw WIFI RTOS task
  */
-void wifi_app_start(led_strip_handle_t led_strip);
+void wifi_app_start();
 
 /**
  * @brief Get the WiFi configuration
@@ -1,50 +1,725 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
+#include "driver/gpio.h"
 #include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
 
+#include "boot_profile.h"
+#include "tasks_common.h"
 #include "ws2812_api.h"
 
-esp_err_t init_ws2812(led_strip_handle_t *led_strip)
+/* Tag used for ESP serial console messages */
+static const char *TAG = "ws2812";
+
+/**
+ * @brief Strip channel: render state, output frames and the transmit task sending them through the backend
+ *
+ * @note Frames are allocated once in init_ws2812(), never on the render path. Everything but the transmit
+ *       fields is owned by the render task.
+ */
+typedef struct
 {
-    led_strip_config_t config = {.strip_gpio_num = LED, .max_leds = MAX_LEDS};
-    led_strip_rmt_config_t rmt_config = {.resolution_hz = 10000000};
-    return led_strip_new_rmt_device(&config, &rmt_config, led_strip);
+    ws2812_render_channel_t render;
+    void *backend_ctx;
+
+    /* Output frames after the LUT. The render task fills the back frame while the transmit task sends the
+     * front one */
+    rgb_color_t *output_frames[2];
+    uint32_t output_back;
+
+    /* Transmit task of the channel, all channels are sent in parallel */
+    TaskHandle_t tx_task;
+    SemaphoreHandle_t tx_done;
+    const rgb_color_t *tx_frame;
+    int64_t tx_frame_start_us;
+} ws2812_channel_t;
+
+/* Strip channels, owned by this module */
+static ws2812_channel_t s_channels[WS2812_MAX_CHANNELS];
+static uint8_t s_channel_count = 0;
+
+/* Backend all channels are sent through */
+static const ws2812_backend_t *s_backend = &ws2812_rmt_backend;
+
+/* Bounded queue of lamp commands, drained by the render task every frame */
+static QueueHandle_t s_command_queue = NULL;
+
+/* Held while commands are queued and while the render task dequeues them, so a batch is never split between
+ * frames and the incoming pixel frames are not swapped while they are written. Commands are applied without it. */
+static SemaphoreHandle_t s_command_lock = NULL;
+
+/* Guards statistics, which are read from other tasks */
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Render task and the timer which wakes it up every frame */
+static TaskHandle_t s_render_task = NULL;
+static esp_timer_handle_t s_frame_timer = NULL;
+
+static ws2812_render_stats_t s_stats;
+
+/* Lamp state published by the render task, guarded by s_stats_lock */
+static ws2812_lamp_state_t s_lamp_state;
+static ws2812_state_listener_t s_state_listener = NULL;
+
+/**
+ * @brief Updates push statistics once a channel frame is on the wire
+ *
+ * @param channel channel index
+ * @param frame_start_us time when the frame rendering started
+ */
+static void ws2812_record_push(uint8_t channel, int64_t frame_start_us)
+{
+    uint32_t push_us = (uint32_t)(esp_timer_get_time() - frame_start_us);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.channel_push_us[channel] = push_us;
+    s_stats.last_push_us = push_us;
+    if (push_us > s_stats.max_push_us)
+    {
+        s_stats.max_push_us = push_us;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * @brief Transmit task of one channel: sends the front output frame while the render task fills the back one
+ *
+ * @param pvParameters channel index
+ */
+static void ws2812_tx_task(void *pvParameters)
+{
+    uint8_t channel = (uint8_t)(uintptr_t)pvParameters;
+    ws2812_channel_t *ch = &s_channels[channel];
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        s_backend->write(ch->backend_ctx, ch->tx_frame, ch->render.led_count);
+        ws2812_record_push(channel, ch->tx_frame_start_us);
+        xSemaphoreGive(ch->tx_done);
+    }
 }
 
-void enable_white_light(led_strip_handle_t led_strip)
+/**
+ * @brief Applies one command to the render state
+ *
+ * @param cmd command taken from the queue
+ * @param now_us current time
+ */
+static void ws2812_apply_command(const ws2812_command_t *cmd, int64_t now_us)
 {
-    for (uint32_t i = 0; i < MAX_LEDS; ++i)
+    switch (cmd->type)
     {
-        led_strip_set_pixel(led_strip, i, 253, 227, 198);
+    case WS2812_CMD_BRIGHTNESS:
+        if (ws2812_render_set_brightness(cmd->brightness))
+        {
+            /* Only the output stage changed, frames have to be pushed again */
+            for (uint8_t c = 0; c < s_channel_count; ++c)
+            {
+                s_channels[c].render.display_dirty = true;
+            }
+        }
+        break;
+
+    case WS2812_CMD_TRANSITION:
+        ws2812_render_set_transition_ms(cmd->transition_ms);
+        break;
+
+    default:
+        for (uint8_t c = 0; c < s_channel_count; ++c)
+        {
+            if (cmd->channel == WS2812_CHANNEL_ALL || cmd->channel == c)
+            {
+                ws2812_render_apply_command(&s_channels[c].render, cmd, now_us);
+            }
+        }
+        break;
     }
-    led_strip_refresh(led_strip);
-    vTaskDelay(100);
-    led_strip_clear(led_strip);
 }
 
-static void _enable_light(led_strip_handle_t led_strip, rgb_color_t color_parameters)
+/**
+ * @brief Empties the command queue and takes over the pixels staged for the dequeued commands
+ *
+ * @note Called with s_command_lock held. The queue never holds more than WS2812_COMMAND_QUEUE_LENGTH commands,
+ *       so every staged pixel command is dequeued and the incoming frames can be swapped with the staging ones.
+ *
+ * @param commands receives the dequeued commands
+ * @return number of dequeued commands
+ */
+static uint32_t ws2812_dequeue_commands(ws2812_command_t commands[WS2812_COMMAND_QUEUE_LENGTH])
 {
-    led_strip_clear(led_strip);
-    for (uint32_t i = 0; i < MAX_LEDS; ++i)
+    uint32_t count = 0;
+    bool pixels = false;
+    while (count < WS2812_COMMAND_QUEUE_LENGTH && xQueueReceive(s_command_queue, &commands[count], 0) == pdTRUE)
     {
-        led_strip_set_pixel(led_strip, i, color_parameters.color_rgb.red, color_parameters.color_rgb.green,
-                            color_parameters.color_rgb.blue);
+        pixels |= commands[count].type == WS2812_CMD_PIXELS;
+        ++count;
     }
-    led_strip_refresh(led_strip);
+
+    if (pixels)
+    {
+        for (uint8_t c = 0; c < s_channel_count; ++c)
+        {
+            ws2812_render_channel_t *ch = &s_channels[c].render;
+            rgb_color_t *staged = ch->pixel_incoming;
+            ch->pixel_incoming = ch->pixel_staging;
+            ch->pixel_staging = staged;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Applies only the dequeued commands which are visible in the next frame.
+ *
+ * @note A frame command (color, gradient, effect...) overrides every older frame and pixel command addressed
+ *       to the same channel, the newest brightness command overrides older ones. Skipped commands are counted
+ *       as coalesced.
+ *
+ * @param commands dequeued commands, oldest first
+ * @param count number of commands
+ * @param now_us current time
+ * @return true if any command was applied
+ */
+static bool ws2812_apply_commands(const ws2812_command_t *commands, uint32_t count, int64_t now_us)
+{
+    int32_t last_frame_all = -1;
+    int32_t last_frame[WS2812_MAX_CHANNELS];
+    int32_t last_brightness = -1;
+    for (uint32_t c = 0; c < WS2812_MAX_CHANNELS; ++c)
+    {
+        last_frame[c] = -1;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (ws2812_render_is_frame_command(commands[i].type))
+        {
+            if (commands[i].channel == WS2812_CHANNEL_ALL)
+            {
+                last_frame_all = i;
+            }
+            else if (commands[i].channel < WS2812_MAX_CHANNELS)
+            {
+                last_frame[commands[i].channel] = i;
+            }
+        }
+        else if (commands[i].type == WS2812_CMD_BRIGHTNESS)
+        {
+            last_brightness = i;
+        }
+    }
+
+    uint32_t coalesced = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bool superseded = false;
+        if (commands[i].type == WS2812_CMD_BRIGHTNESS)
+        {
+            superseded = (int32_t)i < last_brightness;
+        }
+        else if (commands[i].type != WS2812_CMD_TRANSITION)
+        {
+            int32_t last = last_frame_all;
+            if (commands[i].channel < WS2812_MAX_CHANNELS && last_frame[commands[i].channel] > last)
+            {
+                last = last_frame[commands[i].channel];
+            }
+            superseded = (int32_t)i < last;
+        }
+        if (superseded)
+        {
+            ++coalesced;
+            continue;
+        }
+        ws2812_apply_command(&commands[i], now_us);
+    }
+
+    if (coalesced > 0)
+    {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.commands_coalesced += coalesced;
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+
+    return count > coalesced;
+}
+
+/**
+ * @brief Publishes the lamp state and notifies the listener if it differs from the published one
+ */
+static void ws2812_publish_lamp_state()
+{
+    /* Compared with memcmp, so padding is cleared too */
+    ws2812_lamp_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.brightness = ws2812_render_get_brightness();
+    state.channel_count = s_channel_count;
+    for (uint8_t c = 0; c < s_channel_count; ++c)
+    {
+        state.effect[c] = s_channels[c].render.effect;
+        state.still[c] = s_channels[c].render.still;
+        if (state.effect[c] != WS2812_EFFECT_NONE)
+        {
+            state.effect_params[c] = s_channels[c].render.effect_params;
+        }
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    bool changed = memcmp(&state, &s_lamp_state, sizeof(state)) != 0;
+    s_lamp_state = state;
+    ws2812_state_listener_t listener = s_state_listener;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (changed && listener != NULL)
+    {
+        listener();
+    }
+}
+
+/**
+ * @brief Render task: applies queued commands, renders every channel and starts the transmission of all
+ *        dirty channels in parallel at fixed rate
+ *
+ * @note The transmit task of every channel copies its output frame into the led_strip buffer with
+ *       led_strip_set_pixel() and sends it with a blocking led_strip_refresh() in both modes. In blocking mode
+ *       the render task waits until every channel is on the wire, so the refresh time is the time of the
+ *       slowest strip. In DMA mode the RMT peripheral is fed by DMA and the render task does not wait, so the
+ *       next frame is rendered into the other output frame while the previous one is sent. The original ESP32
+ *       has no RMT DMA, there the channel always falls back to blocking mode.
+ *
+ * @param pvParameters parameter which can be passed to the task
+ */
+static void ws2812_render_task(void *pvParameters)
+{
+    int64_t fps_window_start_us = esp_timer_get_time();
+    uint32_t fps_window_frames = 0;
+    bool light_on = false;
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t now_us = esp_timer_get_time();
+
+        ws2812_command_t commands[WS2812_COMMAND_QUEUE_LENGTH];
+        xSemaphoreTake(s_command_lock, portMAX_DELAY);
+        uint32_t count = ws2812_dequeue_commands(commands);
+        xSemaphoreGive(s_command_lock);
+        if (ws2812_apply_commands(commands, count, now_us))
+        {
+            ws2812_publish_lamp_state();
+        }
+
+        bool rendered = false;
+        bool pushed = false;
+        bool wait_for_tx[WS2812_MAX_CHANNELS] = {false};
+        for (uint8_t c = 0; c < s_channel_count; ++c)
+        {
+            ws2812_channel_t *ch = &s_channels[c];
+            rendered |= ws2812_render_frame(&ch->render, now_us);
+            if (!ch->render.display_dirty)
+            {
+                continue;
+            }
+
+            ch->render.display_dirty = false;
+            rgb_color_t *back = ch->output_frames[ch->output_back];
+            ws2812_render_compose_output(&ch->render, back);
+            /* Swap only once the previous frame of the channel has left the wire */
+            xSemaphoreTake(ch->tx_done, portMAX_DELAY);
+            ch->tx_frame = back;
+            ch->tx_frame_start_us = now_us;
+            ch->output_back ^= 1;
+            xTaskNotifyGive(ch->tx_task);
+            wait_for_tx[c] = !ch->render.config.use_dma;
+            pushed = true;
+        }
+        int64_t render_end_us = esp_timer_get_time();
+
+        for (uint8_t c = 0; c < s_channel_count; ++c)
+        {
+            if (wait_for_tx[c])
+            {
+                xSemaphoreTake(s_channels[c].tx_done, portMAX_DELAY);
+                xSemaphoreGive(s_channels[c].tx_done);
+            }
+        }
+        if (pushed)
+        {
+            ++fps_window_frames;
+            if (!light_on)
+            {
+                /* Ignored until the restored lamp state is queued */
+                light_on = boot_profile_end(BOOT_PHASE_LIGHT_ON);
+            }
+        }
+
+        portENTER_CRITICAL(&s_stats_lock);
+        if (rendered)
+        {
+            ++s_stats.frames_rendered;
+        }
+        if (pushed)
+        {
+            ++s_stats.frames_pushed;
+        }
+        s_stats.last_render_us = (uint32_t)(render_end_us - now_us);
+        if (now_us - fps_window_start_us >= 1000000)
+        {
+            s_stats.fps = fps_window_frames;
+            fps_window_frames = 0;
+            fps_window_start_us = now_us;
+        }
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+}
+
+/**
+ * @brief Frame timer callback, wakes up the render task
+ *
+ * @param arg unused
+ */
+static void ws2812_frame_timer_callback(void *arg)
+{
+    xTaskNotifyGive(s_render_task);
+}
+
+void ws2812_default_strip_config(ws2812_strip_config_t *config)
+{
+    config->led_count = WS2812_DEFAULT_LED_COUNT;
+    config->gpio = WS2812_DEFAULT_GPIO;
+    config->color_order = WS2812_ORDER_GRB;
+    config->resolution_hz = WS2812_DEFAULT_RESOLUTION_HZ;
+    config->use_dma = 0;
+}
+
+esp_err_t ws2812_validate_strip_config(const ws2812_strip_config_t *config)
+{
+    if (config->led_count == 0 || config->led_count > WS2812_MAX_LED_COUNT)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(config->gpio) || config->color_order >= WS2812_ORDER_COUNT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->resolution_hz < WS2812_MIN_RESOLUTION_HZ || config->resolution_hz > WS2812_MAX_RESOLUTION_HZ)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+uint8_t ws2812_get_channel_count()
+{
+    return s_channel_count;
+}
+
+esp_err_t ws2812_get_strip_config(uint8_t channel, ws2812_strip_config_t *config)
+{
+    if (channel >= s_channel_count)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *config = s_channels[channel].render.config;
+    return ESP_OK;
+}
+
+esp_err_t ws2812_set_backend(const ws2812_backend_t *backend)
+{
+    if (s_channel_count > 0 || backend == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_backend = backend;
+    return ESP_OK;
+}
+
+/**
+ * @brief Creates backend device, frames and transmit task of one channel
+ *
+ * @param channel channel index
+ * @param strip_config strip geometry, defaults are used if it is invalid
+ * @return ESP_OK, otherwise error of the backend or ESP_ERR_NO_MEM
+ */
+static esp_err_t ws2812_init_channel(uint8_t channel, const ws2812_strip_config_t *strip_config)
+{
+    ws2812_channel_t *ch = &s_channels[channel];
+
+    ws2812_strip_config_t config = *strip_config;
+    if (ws2812_validate_strip_config(&config) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "init_ws2812: invalid configuration of channel %u, using defaults", channel);
+        ws2812_default_strip_config(&config);
+    }
+
+    esp_err_t err = s_backend->init(channel, &config, &ch->backend_ctx);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    if (!ws2812_render_init_channel(&ch->render, &config))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    ch->output_frames[0] = (rgb_color_t *)calloc(2 * config.led_count, sizeof(rgb_color_t));
+    if (ch->output_frames[0] == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    ch->output_frames[1] = ch->output_frames[0] + config.led_count;
+
+    ch->tx_done = xSemaphoreCreateBinary();
+    if (ch->tx_done == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(ch->tx_done);
+
+    if (xTaskCreatePinnedToCore(ws2812_tx_task, "ws2812_tx_task", WS2812_TX_TASK_STACK_SIZE,
+                                (void *)(uintptr_t)channel, WS2812_TX_TASK_PRIORITY, &ch->tx_task,
+                                WS2812_TX_TASK_CORE_ID) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "init_ws2812: channel %u: %u pixels on GPIO %d through %s backend in %s mode", channel,
+             config.led_count, config.gpio, s_backend->name, config.use_dma ? "DMA" : "blocking");
+    return ESP_OK;
+}
+
+esp_err_t init_ws2812(const ws2812_strip_config_t *strip_configs, uint8_t channel_count)
+{
+    if (channel_count == 0 || channel_count > WS2812_MAX_CHANNELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t c = 0; c < channel_count; ++c)
+    {
+        esp_err_t err = ws2812_init_channel(c, &strip_configs[c]);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        s_channel_count = c + 1;
+    }
+
+    s_command_queue = xQueueCreate(WS2812_COMMAND_QUEUE_LENGTH, sizeof(ws2812_command_t));
+    s_command_lock = xSemaphoreCreateMutex();
+    if (s_command_queue == NULL || s_command_lock == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    ws2812_render_init();
+    ws2812_publish_lamp_state();
+
+    if (xTaskCreatePinnedToCore(ws2812_render_task, "ws2812_render_task", WS2812_RENDER_TASK_STACK_SIZE, NULL,
+                                WS2812_RENDER_TASK_PRIORITY, &s_render_task, WS2812_RENDER_TASK_CORE_ID) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t frame_timer_args = {
+        .callback = &ws2812_frame_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ws2812_frame",
+    };
+    esp_err_t err = esp_timer_create(&frame_timer_args, &s_frame_timer);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    ESP_LOGI(TAG, "init_ws2812: %u channels, rendering at %d FPS", s_channel_count, WS2812_RENDER_FPS);
+    return esp_timer_start_periodic(s_frame_timer, WS2812_FRAME_PERIOD_US);
+}
+
+/**
+ * @brief Discards the oldest queued commands until count commands fit, so the newest state always lands
+ *
+ * @note Called with s_command_lock held, count is at most WS2812_COMMAND_QUEUE_LENGTH.
+ *
+ * @param count number of commands about to be queued
+ */
+static void ws2812_make_room(uint32_t count)
+{
+    ws2812_command_t oldest;
+    uint32_t dropped = 0;
+    while (uxQueueSpacesAvailable(s_command_queue) < count && xQueueReceive(s_command_queue, &oldest, 0) == pdTRUE)
+    {
+        ++dropped;
+    }
+
+    if (dropped > 0)
+    {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.commands_dropped += dropped;
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+}
+
+BaseType_t ws2812_send_command(const ws2812_command_t *cmd)
+{
+    if (s_command_queue == NULL)
+    {
+        return pdFALSE;
+    }
+
+    /* The lock is only held to queue or dequeue commands, never while they are applied */
+    xSemaphoreTake(s_command_lock, portMAX_DELAY);
+    ws2812_make_room(1);
+    BaseType_t sent = xQueueSend(s_command_queue, cmd, 0);
+    xSemaphoreGive(s_command_lock);
+    return sent;
+}
+
+/**
+ * @brief Copies colors of a WS2812_CMD_PIXELS command into the incoming staging frames of the addressed channels
+ *
+ * @param cmd pixels command
+ * @param colors colors of the command
+ */
+static void ws2812_stage_pixels(const ws2812_command_t *cmd, const rgb_color_t *colors)
+{
+    for (uint8_t c = 0; c < s_channel_count; ++c)
+    {
+        ws2812_render_channel_t *ch = &s_channels[c].render;
+        if ((cmd->channel != WS2812_CHANNEL_ALL && cmd->channel != c) || cmd->pixels.start >= ch->led_count)
+        {
+            continue;
+        }
+        uint32_t count = MIN(cmd->pixels.count, ch->led_count - cmd->pixels.start);
+        memcpy(&ch->pixel_incoming[cmd->pixels.start], colors, count * sizeof(rgb_color_t));
+    }
+}
+
+esp_err_t ws2812_send_batch(const ws2812_command_t *cmds, uint32_t count, const rgb_color_t *pixels)
+{
+    if (count > WS2812_COMMAND_QUEUE_LENGTH)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (s_command_queue == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_command_lock, portMAX_DELAY);
+    ws2812_make_room(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (cmds[i].type == WS2812_CMD_PIXELS)
+        {
+            ws2812_stage_pixels(&cmds[i], pixels);
+            pixels += cmds[i].pixels.count;
+        }
+        xQueueSend(s_command_queue, &cmds[i], 0);
+    }
+    xSemaphoreGive(s_command_lock);
+
+    return ESP_OK;
+}
+
+void enable_white_light()
+{
+    ws2812_command_t cmd = {
+        .type = WS2812_CMD_FLASH,
+        .channel = WS2812_CHANNEL_ALL,
+        .flash = {.color = color_to_rgb_struct(color_WARM_WHITE), .duration_ms = 100 * portTICK_PERIOD_MS},
+    };
+    ws2812_send_command(&cmd);
+}
+
+void enable_light(rgb_color_t color)
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_COLOR, .channel = WS2812_CHANNEL_ALL, .color = color};
+    ws2812_send_command(&cmd);
+}
+
+void enable_light_color(color_e color)
+{
+    enable_light(color_to_rgb_struct(color));
+}
+
+void disable_light()
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_OFF, .channel = WS2812_CHANNEL_ALL};
+    ws2812_send_command(&cmd);
+}
+
+void ws2812_set_pixel(uint8_t channel, uint32_t index, rgb_color_t color)
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_PIXEL, .channel = channel, .pixel = {.index = index, .color = color}};
+    ws2812_send_command(&cmd);
+}
+
+void ws2812_fill_gradient(uint8_t channel, rgb_color_t from, rgb_color_t to)
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_GRADIENT, .channel = channel, .gradient = {.from = from, .to = to}};
+    ws2812_send_command(&cmd);
+}
+
+void ws2812_start_effect(uint8_t channel, ws2812_effect_e effect, const ws2812_effect_params_t *params)
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_EFFECT, .channel = channel, .effect = {.effect = effect}};
+    const ws2812_effect_info_t *info = ws2812_effect_get(effect);
+    if (params != NULL)
+    {
+        cmd.effect.params = *params;
+    }
+    else if (info != NULL)
+    {
+        cmd.effect.params = info->default_params;
+    }
+    ws2812_send_command(&cmd);
+}
+
+void ws2812_set_brightness(uint8_t brightness)
+{
+    ws2812_command_t cmd = {.type = WS2812_CMD_BRIGHTNESS, .channel = WS2812_CHANNEL_ALL, .brightness = brightness};
+    ws2812_send_command(&cmd);
+}
+
+uint8_t ws2812_get_brightness()
+{
+    return ws2812_render_get_brightness();
+}
+
+void ws2812_set_transition_ms(uint32_t transition_ms)
+{
+    ws2812_command_t cmd = {
+        .type = WS2812_CMD_TRANSITION, .channel = WS2812_CHANNEL_ALL, .transition_ms = transition_ms};
+    ws2812_send_command(&cmd);
 }
 
-void enable_light(led_strip_handle_t led_strip, rgb_color_t color)
+void ws2812_get_render_stats(ws2812_render_stats_t *stats)
 {
-    _enable_light(led_strip, color);
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    stats->queue_depth = s_command_queue != NULL ? uxQueueMessagesWaiting(s_command_queue) : 0;
 }
 
-void enable_light_color(led_strip_handle_t led_strip, color_e color)
+void ws2812_get_lamp_state(ws2812_lamp_state_t *state)
 {
-    enable_light(led_strip, color_to_rgb_struct(color));
+    portENTER_CRITICAL(&s_stats_lock);
+    *state = s_lamp_state;
+    portEXIT_CRITICAL(&s_stats_lock);
 }
 
-void disable_light(led_strip_handle_t led_strip)
+void ws2812_set_state_listener(ws2812_state_listener_t listener)
 {
-    led_strip_clear(led_strip);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_state_listener = listener;
+    portEXIT_CRITICAL(&s_stats_lock);
 }
@@ -1,33 +1,223 @@
 #ifndef LED_STRIP_WS2812_H_
-#define LED_STRIP_WS2812_H_ 
+#define LED_STRIP_WS2812_H_
 
-#include "led_strip.h"
-#include "colors.h"
+#include "freertos/FreeRTOS.h"
 
-#define LED 25
-#define MAX_LEDS 15
+#include "ws2812_backend.h"
+#include "ws2812_render.h"
+
+/* Length of the lamp command queue drained by the render task */
+#define WS2812_COMMAND_QUEUE_LENGTH 16
+
+/**
+ * @brief Render loop and command queue statistics
+ */
+typedef struct
+{
+    uint32_t frames_rendered;    /* Frames composed into the framebuffer by an effect */
+    uint32_t frames_pushed;      /* Dirty frames sent to the strip */
+    uint32_t fps;                /* Frames pushed during the last second */
+    uint32_t last_render_us;     /* Render task time of the last frame, without waiting for the transmission */
+    uint32_t last_push_us;       /* Wall time of the last channel frame, from render start until it is on the wire */
+    uint32_t max_push_us;        /* Longest push since boot */
+    uint32_t queue_depth;        /* Commands waiting in the queue */
+    uint32_t commands_dropped;   /* Oldest commands discarded to make room in a full queue */
+    uint32_t commands_coalesced; /* Commands skipped because a newer one overrides them */
+    uint32_t channel_push_us[WS2812_MAX_CHANNELS]; /* Wall time of the last frame of each channel */
+} ws2812_render_stats_t;
+
+/**
+ * @brief Lamp state visible to the user, updated by the render task once queued commands are applied
+ */
+typedef struct
+{
+    uint8_t brightness;                          /* Global brightness */
+    uint8_t channel_count;                       /* Initialized channels */
+    ws2812_effect_e effect[WS2812_MAX_CHANNELS]; /* Running effect of each channel, NONE for a still frame */
+    ws2812_effect_params_t effect_params[WS2812_MAX_CHANNELS]; /* Parameters of the running effects */
+    ws2812_still_t still[WS2812_MAX_CHANNELS];                 /* Still frame of each channel, under the effect */
+} ws2812_lamp_state_t;
+
+/**
+ * @brief Called from the render task when the lamp state changed, must not block
+ */
+typedef void (*ws2812_state_listener_t)(void);
+
+/**
+ * @brief Fill the strip configuration with compile-time defaults
+ *
+ * @param config pointer to configuration which is filled
+ */
+void ws2812_default_strip_config(ws2812_strip_config_t *config);
+
+/**
+ * @brief Check that the strip configuration can be applied
+ *
+ * @param config configuration to be checked
+ * @return
+ *      - ESP_OK: configuration is valid
+ *      - ESP_ERR_INVALID_SIZE: pixel count is 0 or above WS2812_MAX_LED_COUNT
+ *      - ESP_ERR_INVALID_ARG: GPIO, color order or RMT resolution is out of range
+ */
+esp_err_t ws2812_validate_strip_config(const ws2812_strip_config_t *config);
+
+/**
+ * @brief Get number of initialized strip channels
+ *
+ * @return channel count
+ */
+uint8_t ws2812_get_channel_count();
+
+/**
+ * @brief Get the configuration the strip channel is running with
+ *
+ * @param channel channel index
+ * @param config pointer where configuration is copied
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if there is no such channel
+ */
+esp_err_t ws2812_get_strip_config(uint8_t channel, ws2812_strip_config_t *config);
 
 /**
- * @brief Init WS2812 led strip
+ * @brief Select the backend the strips are sent through, ws2812_rmt_backend by default
  *
- * @param led_strip pointer on initiated strip
+ * @param backend strip backend
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if strips are already initialized
+ */
+esp_err_t ws2812_set_backend(const ws2812_backend_t *backend);
+
+/**
+ * @brief Init WS2812 led strips, allocates their framebuffers and starts the render task
+ *
+ * @param strip_configs array of strip geometries, one per channel, defaults are used for invalid ones
+ * @param channel_count number of channels in range [1, WS2812_MAX_CHANNELS]
  * @return
  *      - ESP_OK: create LED strip handle successfully
  *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
  *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
  *      - ESP_FAIL: create LED strip handle failed because some other error
  */
-esp_err_t init_ws2812(led_strip_handle_t *led_strip);
+esp_err_t init_ws2812(const ws2812_strip_config_t *strip_configs, uint8_t channel_count);
+
+/**
+ * @brief Sends a command to the render task queue, never waits for room in the queue
+ *
+ * @note A full queue discards its oldest command, so the newest state always lands. The command lock is only held
+ *       while commands are queued or dequeued, never while the render task applies them.
+ *
+ * @param cmd command to be sent
+ * @return pdTRUE if the command was queued, pdFALSE if the strips are not initialized
+ */
+BaseType_t ws2812_send_command(const ws2812_command_t *cmd);
 
 /**
- * @brief Write "warm white" color to led strip and refreshes its state
+ * @brief Sends a batch of commands which the render task applies together in one frame, never waits for room
+ *        in the queue
  *
- * @param led_strip pointer on initiated strip
+ * @note WS2812_CMD_PIXELS commands take their colors from pixels, each one the next pixels.count colors. The
+ *       colors are copied into the incoming staging frame of the addressed channels, so the caller may reuse the
+ *       buffer. A full queue discards its oldest commands to make room for the whole batch.
+ *
+ * @param cmds commands in the order they are applied
+ * @param count number of commands
+ * @param pixels colors of WS2812_CMD_PIXELS commands, may be NULL if there are none
+ * @return
+ *      - ESP_OK: whole batch was queued
+ *      - ESP_ERR_INVALID_SIZE: batch is longer than the command queue
+ *      - ESP_ERR_INVALID_STATE: strips are not initialized
  */
-void enable_white_light(led_strip_handle_t led_strip);
+esp_err_t ws2812_send_batch(const ws2812_command_t *cmds, uint32_t count, const rgb_color_t *pixels);
 
-void enable_light(led_strip_handle_t led_strip, rgb_color_t color);
-void enable_light_color(led_strip_handle_t led_strip, color_e color);
-void disable_light(led_strip_handle_t led_strip);
+/**
+ * @brief Flash "warm white" color on all strips, it is turned off by the render task afterwards
+ */
+void enable_white_light();
+
+/**
+ * @brief Fill framebuffers of all channels with one color, stops running effect
+ *
+ * @param color color of all pixels
+ */
+void enable_light(rgb_color_t color);
+
+/**
+ * @brief Fill framebuffers of all channels with one of predefined colors, stops running effect
+ *
+ * @param color color from color_e enum
+ */
+void enable_light_color(color_e color);
+
+/**
+ * @brief Turn all pixels of all channels off, stops running effect
+ */
+void disable_light();
+
+/**
+ * @brief Set color of a single pixel
+ *
+ * @param channel channel index or WS2812_CHANNEL_ALL
+ * @param index pixel index, ignored if out of strip
+ * @param color pixel color
+ */
+void ws2812_set_pixel(uint8_t channel, uint32_t index, rgb_color_t color);
+
+/**
+ * @brief Fill the framebuffer with linear gradient, stops running effect
+ *
+ * @param channel channel index or WS2812_CHANNEL_ALL
+ * @param from color of the first pixel
+ * @param to color of the last pixel
+ */
+void ws2812_fill_gradient(uint8_t channel, rgb_color_t from, rgb_color_t to);
+
+/**
+ * @brief Start animated effect, WS2812_EFFECT_NONE stops the running one
+ *
+ * @param channel channel index or WS2812_CHANNEL_ALL
+ * @param effect effect from ws2812_effect_e enum
+ * @param params effect parameters, NULL for the defaults from the effect registry
+ */
+void ws2812_start_effect(uint8_t channel, ws2812_effect_e effect, const ws2812_effect_params_t *params);
+
+/**
+ * @brief Set global brightness, only the output LUT is rebuilt, the framebuffer is kept as is
+ *
+ * @param brightness brightness in range [0, 255], scaled before gamma correction so dimming is perceptually even
+ */
+void ws2812_set_brightness(uint8_t brightness);
+
+/**
+ * @brief Get global brightness
+ *
+ * @return brightness in range [0, 255]
+ */
+uint8_t ws2812_get_brightness();
+
+/**
+ * @brief Set duration of the cross-fade applied to every following frame change
+ *
+ * @param transition_ms fade duration, 0 switches frames instantly
+ */
+void ws2812_set_transition_ms(uint32_t transition_ms);
+
+/**
+ * @brief Get the lamp state
+ *
+ * @param state pointer where the state is copied
+ */
+void ws2812_get_lamp_state(ws2812_lamp_state_t *state);
+
+/**
+ * @brief Set the function called whenever the lamp state changes, replaces the previous one
+ *
+ * @param listener listener called from the render task, NULL to remove it
+ */
+void ws2812_set_state_listener(ws2812_state_listener_t listener);
+
+/**
+ * @brief Get render loop statistics
+ *
+ * @param stats pointer where statistics are copied
+ */
+void ws2812_get_render_stats(ws2812_render_stats_t *stats);
 
-#endif /* LED_STRIP_WS2812_H_ */
\ No newline at end of file
+#endif /* LED_STRIP_WS2812_H_ */
@@ -0,0 +1,51 @@
+#ifndef WS2812_BACKEND_H_
+#define WS2812_BACKEND_H_
+
+#include "esp_err.h"
+
+#include "ws2812_render.h"
+
+/**
+ * @brief Strip backend, sends output frames of one channel somewhere: to the RMT peripheral or to a simulator
+ *
+ * @note Every channel has its own backend context, write is called from the transmit task of the channel only.
+ */
+typedef struct
+{
+    const char *name;
+
+    /**
+     * @brief Creates the device of one channel
+     *
+     * @param channel channel index
+     * @param config strip geometry, the backend may clear use_dma if DMA is not available
+     * @param ctx pointer where the backend context is stored
+     * @return ESP_OK, otherwise backend specific error
+     */
+    esp_err_t (*init)(uint8_t channel, ws2812_strip_config_t *config, void **ctx);
+
+    /**
+     * @brief Sends the output frame, blocks until it is on the wire
+     *
+     * @param ctx backend context
+     * @param frame output frame, see ws2812_render_compose_output()
+     * @param led_count number of pixels in the frame
+     * @return ESP_OK, otherwise backend specific error
+     */
+    esp_err_t (*write)(void *ctx, const rgb_color_t *frame, uint32_t led_count);
+
+    /**
+     * @brief Releases the device and the context
+     *
+     * @param ctx backend context
+     */
+    void (*deinit)(void *ctx);
+} ws2812_backend_t;
+
+/* led_strip RMT driver, used on the target */
+extern const ws2812_backend_t ws2812_rmt_backend;
+
+/* Host simulator, records frames with timestamps to memory or to a file */
+extern const ws2812_backend_t ws2812_sim_backend;
+
+#endif /* WS2812_BACKEND_H_ */
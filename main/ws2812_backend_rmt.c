@@ -0,0 +1,66 @@
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "led_strip.h"
+
+#include "ws2812_backend.h"
+
+/* Tag used for ESP serial console messages */
+static const char *TAG = "ws2812_rmt";
+
+/* RMT memory block size used in DMA mode, the whole frame is fed by DMA in large blocks */
+#define WS2812_DMA_MEM_BLOCK_SYMBOLS 1024
+
+static esp_err_t ws2812_rmt_init(uint8_t channel, ws2812_strip_config_t *strip_config, void **ctx)
+{
+    led_strip_handle_t led_strip = NULL;
+    led_strip_config_t config = {.strip_gpio_num = strip_config->gpio, .max_leds = strip_config->led_count};
+    led_strip_rmt_config_t rmt_config = {.resolution_hz = strip_config->resolution_hz};
+    if (strip_config->use_dma)
+    {
+        rmt_config.flags.with_dma = 1;
+        rmt_config.mem_block_symbols = WS2812_DMA_MEM_BLOCK_SYMBOLS;
+    }
+    esp_err_t err = led_strip_new_rmt_device(&config, &rmt_config, &led_strip);
+    if (err != ESP_OK && strip_config->use_dma)
+    {
+        /* Not every chip has DMA for RMT, e.g. the original ESP32 */
+        ESP_LOGW(TAG, "channel %u: RMT DMA is not available (%s), using blocking mode", channel,
+                 esp_err_to_name(err));
+        strip_config->use_dma = 0;
+        rmt_config.flags.with_dma = 0;
+        rmt_config.mem_block_symbols = 0;
+        err = led_strip_new_rmt_device(&config, &rmt_config, &led_strip);
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    *ctx = led_strip;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_rmt_write(void *ctx, const rgb_color_t *frame, uint32_t led_count)
+{
+    led_strip_handle_t led_strip = (led_strip_handle_t)ctx;
+
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        led_strip_set_pixel(led_strip, i, frame[i].color_rgb.red, frame[i].color_rgb.green,
+                            frame[i].color_rgb.blue);
+    }
+    return led_strip_refresh(led_strip);
+}
+
+static void ws2812_rmt_deinit(void *ctx)
+{
+    led_strip_del((led_strip_handle_t)ctx);
+}
+
+const ws2812_backend_t ws2812_rmt_backend = {
+    .name = "rmt",
+    .init = ws2812_rmt_init,
+    .write = ws2812_rmt_write,
+    .deinit = ws2812_rmt_deinit,
+};
@@ -0,0 +1,315 @@
+#include <string.h>
+
+#include "ws2812_effects.h"
+
+/* Hue wheel of ws2812_hue_to_rgb(), 6 sectors of 256 steps */
+#define WS2812_HUE_WHEEL 1536
+
+/* Fire simulation runs at fixed step so it looks the same at any frame rate */
+#define WS2812_FIRE_STEP_MS 16
+#define WS2812_FIRE_COOLING 55
+#define WS2812_FIRE_SPARK_PIXELS 7
+
+/**
+ * @brief Blends two colors
+ *
+ * @param from color at level 0
+ * @param to color at level 256
+ * @param level blend level in range [0, 256]
+ * @return blended color
+ */
+static inline rgb_color_t ws2812_blend(rgb_color_t from, rgb_color_t to, uint32_t level)
+{
+    rgb_color_t color;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        color.color[c] = (uint8_t)(from.color[c] + ((((int32_t)to.color[c] - from.color[c]) * (int32_t)level) >> 8));
+    }
+    return color;
+}
+
+/**
+ * @brief Triangle wave
+ *
+ * @param phase position in the period
+ * @param period wave period, at least 2
+ * @return level in range [0, 256], 0 at the start of the period and 256 in the middle
+ */
+static inline uint32_t ws2812_triangle(uint32_t phase, uint32_t period)
+{
+    uint32_t half = period / 2;
+    uint32_t pos = phase < half ? phase : period - phase;
+    return pos >= half ? 256 : (pos << 8) / half;
+}
+
+/**
+ * @brief Fully saturated color of the hue wheel
+ *
+ * @param hue hue in range [0, WS2812_HUE_WHEEL)
+ * @return color
+ */
+static inline rgb_color_t ws2812_hue_to_rgb(uint32_t hue)
+{
+    uint8_t x = (uint8_t)hue;
+    rgb_color_t color;
+    switch (hue >> 8)
+    {
+    case 0:
+        color.color_rgb.red = 255, color.color_rgb.green = x, color.color_rgb.blue = 0;
+        break;
+    case 1:
+        color.color_rgb.red = 255 - x, color.color_rgb.green = 255, color.color_rgb.blue = 0;
+        break;
+    case 2:
+        color.color_rgb.red = 0, color.color_rgb.green = 255, color.color_rgb.blue = x;
+        break;
+    case 3:
+        color.color_rgb.red = 0, color.color_rgb.green = 255 - x, color.color_rgb.blue = 255;
+        break;
+    case 4:
+        color.color_rgb.red = x, color.color_rgb.green = 0, color.color_rgb.blue = 255;
+        break;
+    default:
+        color.color_rgb.red = 255, color.color_rgb.green = 0, color.color_rgb.blue = 255 - x;
+        break;
+    }
+    return color;
+}
+
+/**
+ * @brief xorshift32 pseudo random generator
+ *
+ * @param state generator state, never 0
+ * @return next random number
+ */
+static inline uint32_t ws2812_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Integer hash, used to derive stable per-pixel randomness from the pixel index
+ */
+static inline uint32_t ws2812_hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief Chase: a segment of primary color moves over secondary background
+ */
+static void ws2812_effect_chase(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    uint32_t head = (uint32_t)((uint64_t)(t_ms % p->period_ms) * led_count / p->period_ms);
+
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        uint32_t distance = i >= head ? i - head : i + led_count - head;
+        frame[i] = distance < p->length ? p->primary : p->secondary;
+    }
+}
+
+/**
+ * @brief Breathe: the whole strip fades between primary and secondary color
+ */
+static void ws2812_effect_breathe(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                  const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    rgb_color_t color = ws2812_blend(p->primary, p->secondary, ws2812_triangle(t_ms % p->period_ms, p->period_ms));
+
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        frame[i] = color;
+    }
+}
+
+/**
+ * @brief Rainbow: hue wheels scroll along the strip, hue is stepped in Q16 fixed point
+ */
+static void ws2812_effect_rainbow(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                  const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    const uint32_t wheel_q16 = (uint32_t)WS2812_HUE_WHEEL << 16;
+    uint32_t waves = p->length == 0 ? 1 : (p->length > led_count ? led_count : p->length);
+    uint32_t step = (uint32_t)(((uint64_t)wheel_q16 * waves) / led_count);
+    uint32_t hue = (uint32_t)(((uint64_t)(t_ms % p->period_ms) * wheel_q16) / p->period_ms);
+
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        frame[i] = ws2812_hue_to_rgb(hue >> 16);
+        hue += step;
+        if (hue >= wheel_q16)
+        {
+            hue -= wheel_q16;
+        }
+    }
+}
+
+/**
+ * @brief Twinkle: pixels sparkle to primary color and back, each pixel has its own phase and a new chance
+ *        to be lit every period
+ */
+static void ws2812_effect_twinkle(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                  const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        uint32_t h = ws2812_hash(i);
+        uint32_t local_t = t_ms + h % p->period_ms;
+        uint32_t cycle = local_t / p->period_ms;
+        if ((ws2812_hash(h ^ cycle) & 0xFF) >= p->length)
+        {
+            frame[i] = p->secondary;
+            continue;
+        }
+        uint32_t level = ws2812_triangle(local_t - cycle * p->period_ms, p->period_ms);
+        frame[i] = ws2812_blend(p->secondary, p->primary, level);
+    }
+}
+
+/**
+ * @brief Fire: heat cools down, rises from the first pixel and new sparks ignite near it, heat is mapped to
+ *        black - red - yellow - white
+ */
+static void ws2812_effect_fire(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                               const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    uint8_t *heat = state->scratch;
+    uint32_t steps = t_ms >= state->last_step_ms ? (t_ms - state->last_step_ms) / WS2812_FIRE_STEP_MS : 1;
+    if (steps > 3)
+    {
+        steps = 3;
+    }
+    if (steps > 0)
+    {
+        state->last_step_ms = t_ms;
+    }
+
+    uint32_t max_cooling = WS2812_FIRE_COOLING * 10 / led_count + 2;
+    uint32_t spark_pixels = led_count < WS2812_FIRE_SPARK_PIXELS ? led_count : WS2812_FIRE_SPARK_PIXELS;
+    for (uint32_t s = 0; s < steps; ++s)
+    {
+        for (uint32_t i = 0; i < led_count; ++i)
+        {
+            uint32_t cooling = ws2812_random(&state->rng) % max_cooling;
+            heat[i] = heat[i] > cooling ? heat[i] - cooling : 0;
+        }
+        for (uint32_t i = led_count - 1; i >= 2; --i)
+        {
+            heat[i] = (uint8_t)((heat[i - 1] + 2 * heat[i - 2]) / 3);
+        }
+        if ((ws2812_random(&state->rng) & 0xFF) < p->length)
+        {
+            uint32_t y = ws2812_random(&state->rng) % spark_pixels;
+            uint32_t spark = heat[y] + 160 + ws2812_random(&state->rng) % 96;
+            heat[y] = spark > 255 ? 255 : (uint8_t)spark;
+        }
+    }
+
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        uint32_t t192 = heat[i] * 191 / 255;
+        uint8_t ramp = (uint8_t)((t192 & 0x3F) << 2);
+        rgb_color_t color;
+        if (t192 & 0x80)
+        {
+            color.color_rgb.red = 255, color.color_rgb.green = 255, color.color_rgb.blue = ramp;
+        }
+        else if (t192 & 0x40)
+        {
+            color.color_rgb.red = 255, color.color_rgb.green = ramp, color.color_rgb.blue = 0;
+        }
+        else
+        {
+            color.color_rgb.red = ramp, color.color_rgb.green = 0, color.color_rgb.blue = 0;
+        }
+        frame[i] = color;
+    }
+}
+
+/**
+ * @brief Static: the whole strip has primary color
+ */
+static void ws2812_effect_static(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                 const ws2812_effect_params_t *p, ws2812_effect_state_t *state)
+{
+    for (uint32_t i = 0; i < led_count; ++i)
+    {
+        frame[i] = p->primary;
+    }
+}
+
+/* Effect registry, indexed by ws2812_effect_e */
+static const ws2812_effect_info_t s_effects[WS2812_EFFECT_COUNT] = {
+    [WS2812_EFFECT_CHASE] = {.name = "chase",
+                             .render = ws2812_effect_chase,
+                             .animated = true,
+                             .default_params = {.primary = RGB_COLOR(253, 227, 108),
+                                                .secondary = RGB_COLOR(0, 0, 0),
+                                                .period_ms = 2000,
+                                                .length = 3}},
+    [WS2812_EFFECT_BREATHE] = {.name = "breathe",
+                               .render = ws2812_effect_breathe,
+                               .animated = true,
+                               .default_params = {.primary = RGB_COLOR(253, 227, 108),
+                                                  .secondary = RGB_COLOR(0, 0, 0),
+                                                  .period_ms = 4000}},
+    [WS2812_EFFECT_RAINBOW] = {.name = "rainbow",
+                               .render = ws2812_effect_rainbow,
+                               .animated = true,
+                               .default_params = {.period_ms = 5000, .length = 1}},
+    [WS2812_EFFECT_TWINKLE] = {.name = "twinkle",
+                               .render = ws2812_effect_twinkle,
+                               .animated = true,
+                               .default_params = {.primary = RGB_COLOR(255, 255, 255),
+                                                  .secondary = RGB_COLOR(0, 0, 8),
+                                                  .period_ms = 1500,
+                                                  .length = 40}},
+    [WS2812_EFFECT_FIRE] = {.name = "fire",
+                            .render = ws2812_effect_fire,
+                            .animated = true,
+                            .default_params = {.period_ms = 1000, .length = 120}},
+    [WS2812_EFFECT_STATIC] = {.name = "static",
+                              .render = ws2812_effect_static,
+                              .animated = false,
+                              .default_params = {.primary = RGB_COLOR(253, 227, 108), .period_ms = 1000}},
+};
+
+const ws2812_effect_info_t *ws2812_effect_get(ws2812_effect_e effect)
+{
+    if ((unsigned)effect >= WS2812_EFFECT_COUNT || s_effects[effect].render == NULL)
+    {
+        return NULL;
+    }
+    return &s_effects[effect];
+}
+
+ws2812_effect_e ws2812_effect_find(const char *name)
+{
+    for (uint32_t e = 0; e < WS2812_EFFECT_COUNT; ++e)
+    {
+        if (s_effects[e].name != NULL && strcmp(s_effects[e].name, name) == 0)
+        {
+            return (ws2812_effect_e)e;
+        }
+    }
+    return WS2812_EFFECT_NONE;
+}
+
+void ws2812_effect_reset_state(ws2812_effect_state_t *state, uint32_t led_count)
+{
+    memset(state->scratch, 0, led_count);
+    state->rng = 0x9e3779b9;
+    state->last_step_ms = 0;
+}
@@ -0,0 +1,95 @@
+#ifndef WS2812_EFFECTS_H_
+#define WS2812_EFFECTS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "colors.h"
+
+/**
+ * @brief Animated effects rendered into the framebuffer by the render task, ids are stable
+ */
+typedef enum
+{
+    WS2812_EFFECT_NONE = 0,
+    WS2812_EFFECT_CHASE,
+    WS2812_EFFECT_BREATHE,
+    WS2812_EFFECT_RAINBOW,
+    WS2812_EFFECT_TWINKLE,
+    WS2812_EFFECT_FIRE,
+    WS2812_EFFECT_STATIC,
+    WS2812_EFFECT_COUNT
+} ws2812_effect_e;
+
+/**
+ * @brief Parameters of the animated effect
+ *
+ * @note CHASE moves `length` pixels of primary color over secondary background,
+ *       BREATHE breathes between primary and secondary color,
+ *       RAINBOW scrolls `length` hue wheels along the strip once per period,
+ *       TWINKLE sparkles primary color over secondary background, `length` of 255 pixels are lit at a time,
+ *       FIRE simulates flames rising from the first pixel, `length` is the spark chance out of 255,
+ *       STATIC fills the strip with primary color.
+ */
+typedef struct
+{
+    rgb_color_t primary;
+    rgb_color_t secondary;
+    uint32_t period_ms;
+    uint16_t length;
+} ws2812_effect_params_t;
+
+/**
+ * @brief Per-channel state of stateful effects, reset when an effect starts
+ */
+typedef struct
+{
+    uint8_t *scratch; /* led_count bytes of per-pixel state, e.g. heat of the fire */
+    uint32_t rng;     /* xorshift32 state, never 0 */
+    uint32_t last_step_ms;
+} ws2812_effect_state_t;
+
+/**
+ * @brief Effect render kernel, fills the whole frame for time t_ms since the effect start
+ *
+ * @note Kernels use integer math only and are called once per frame, the pixel loop has no indirect calls.
+ */
+typedef void (*ws2812_effect_kernel_t)(rgb_color_t *frame, uint32_t led_count, uint32_t t_ms,
+                                       const ws2812_effect_params_t *params, ws2812_effect_state_t *state);
+
+/**
+ * @brief Entry of the effect registry
+ */
+typedef struct
+{
+    const char *name;
+    ws2812_effect_kernel_t render;
+    bool animated; /* Not animated effects are rendered only once when started */
+    ws2812_effect_params_t default_params;
+} ws2812_effect_info_t;
+
+/**
+ * @brief Get effect from the registry
+ *
+ * @param effect effect id
+ * @return registry entry, NULL for WS2812_EFFECT_NONE and unknown ids
+ */
+const ws2812_effect_info_t *ws2812_effect_get(ws2812_effect_e effect);
+
+/**
+ * @brief Find effect by name
+ *
+ * @param name effect name, e.g. "rainbow"
+ * @return effect id, WS2812_EFFECT_NONE if there is no such effect
+ */
+ws2812_effect_e ws2812_effect_find(const char *name);
+
+/**
+ * @brief Resets effect state before the effect starts
+ *
+ * @param state effect state of the channel
+ * @param led_count number of pixels, size of the scratch buffer
+ */
+void ws2812_effect_reset_state(ws2812_effect_state_t *state, uint32_t led_count);
+
+#endif /* WS2812_EFFECTS_H_ */
@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ws2812_render.h"
+
+/* Channel positions on the wire for each ws2812_color_order_e, 0 - red, 1 - green, 2 - blue */
+static const uint8_t s_color_order_map[WS2812_ORDER_COUNT][3] = {
+    [WS2812_ORDER_GRB] = {1, 0, 2}, [WS2812_ORDER_RGB] = {0, 1, 2}, [WS2812_ORDER_BRG] = {2, 0, 1},
+    [WS2812_ORDER_RBG] = {0, 2, 1}, [WS2812_ORDER_GBR] = {1, 2, 0}, [WS2812_ORDER_BGR] = {2, 1, 0},
+};
+
+/* Duration of the cross-fade, shared by all channels */
+static uint32_t s_transition_ms = WS2812_DEFAULT_TRANSITION_MS;
+
+/* Perceptual gamma (2.2) correction table */
+static const uint8_t s_gamma_lut[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+    6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+    12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+    20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+    30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+    42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+    91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+/* Output stage: global brightness followed by gamma, applied to every pixel before the refresh */
+static uint8_t s_output_lut[256];
+static uint8_t s_brightness = UINT8_MAX;
+
+/**
+ * @brief Linear interpolation of one color channel
+ *
+ * @param from channel value at pos == 0
+ * @param to channel value at pos == max
+ * @param pos position in range [0, max]
+ * @param max range of position
+ * @return interpolated channel value
+ */
+static inline uint8_t ws2812_lerp(uint8_t from, uint8_t to, uint32_t pos, uint32_t max)
+{
+    return (uint8_t)((int32_t)from + ((int32_t)to - (int32_t)from) * (int32_t)pos / (int32_t)max);
+}
+
+/**
+ * @brief Linear interpolation of the whole color
+ */
+static rgb_color_t ws2812_lerp_color(rgb_color_t from, rgb_color_t to, uint32_t pos, uint32_t max)
+{
+    rgb_color_t color;
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        color.color[c] = ws2812_lerp(from.color[c], to.color[c], pos, max);
+    }
+    return color;
+}
+
+/**
+ * @brief Starts the cross-fade from the currently displayed frame to the framebuffer
+ *
+ * @param ch strip channel
+ * @param now_us current time
+ */
+static void ws2812_start_transition(ws2812_render_channel_t *ch, int64_t now_us)
+{
+    memcpy(ch->transition_start, ch->display, ch->led_count * sizeof(rgb_color_t));
+    ch->transition_start_us = now_us;
+    ch->transition_active = s_transition_ms > 0;
+}
+
+/**
+ * @brief Blends the displayed frame between transition start and the framebuffer.
+ *
+ * @note Progress is a Q16 fixed-point fraction, so each channel is start + (delta * progress >> 16):
+ *       monotonic in time and exactly the target once progress reaches 1.0.
+ *
+ * @param ch strip channel
+ * @param now_us current time
+ */
+static void ws2812_blend_display(ws2812_render_channel_t *ch, int64_t now_us)
+{
+    if (!ch->transition_active)
+    {
+        memcpy(ch->display, ch->framebuffer, ch->led_count * sizeof(rgb_color_t));
+        return;
+    }
+
+    uint64_t elapsed_us = (uint64_t)(now_us - ch->transition_start_us);
+    uint64_t duration_us = (uint64_t)s_transition_ms * 1000;
+    if (elapsed_us >= duration_us)
+    {
+        memcpy(ch->display, ch->framebuffer, ch->led_count * sizeof(rgb_color_t));
+        ch->transition_active = false;
+        return;
+    }
+
+    int32_t progress = (int32_t)((elapsed_us << 16) / duration_us);
+    for (uint32_t i = 0; i < ch->led_count; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            int32_t start = ch->transition_start[i].color[c];
+            int32_t delta = (int32_t)ch->framebuffer[i].color[c] - start;
+            ch->display[i].color[c] = (uint8_t)(start + ((delta * progress) >> 16));
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds the output LUT for the given brightness
+ *
+ * @param brightness global brightness, 255 is full brightness
+ */
+static void ws2812_build_output_lut(uint8_t brightness)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        s_output_lut[i] = s_gamma_lut[(i * brightness + UINT8_MAX / 2) / UINT8_MAX];
+    }
+    s_brightness = brightness;
+}
+
+/**
+ * @brief Fills the framebuffer with one color
+ *
+ * @param ch strip channel
+ * @param color color of all pixels
+ */
+static void ws2812_fill(ws2812_render_channel_t *ch, rgb_color_t color)
+{
+    for (uint32_t i = 0; i < ch->led_count; ++i)
+    {
+        ch->framebuffer[i] = color;
+    }
+}
+
+/**
+ * @brief Fills the framebuffer with linear gradient
+ *
+ * @param ch strip channel
+ * @param from color of the first pixel
+ * @param to color of the last pixel
+ */
+static void ws2812_fill_gradient_frame(ws2812_render_channel_t *ch, rgb_color_t from, rgb_color_t to)
+{
+    uint32_t last = ch->led_count > 1 ? ch->led_count - 1 : 1;
+
+    for (uint32_t i = 0; i < ch->led_count; ++i)
+    {
+        ch->framebuffer[i] = ws2812_lerp_color(from, to, i, last);
+    }
+}
+
+void ws2812_render_init()
+{
+    ws2812_build_output_lut(s_brightness);
+}
+
+bool ws2812_render_init_channel(ws2812_render_channel_t *ch, const ws2812_strip_config_t *config)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->config = *config;
+    ch->led_count = config->led_count;
+
+    /* Target, displayed, transition start and both staging frames and the effect scratch share one allocation */
+    ch->framebuffer = (rgb_color_t *)calloc(ch->led_count, 5 * sizeof(rgb_color_t) + 1);
+    if (ch->framebuffer == NULL)
+    {
+        return false;
+    }
+    ch->display = ch->framebuffer + ch->led_count;
+    ch->transition_start = ch->display + ch->led_count;
+    ch->pixel_staging = ch->transition_start + ch->led_count;
+    ch->pixel_incoming = ch->pixel_staging + ch->led_count;
+    ch->effect_state.scratch = (uint8_t *)(ch->pixel_incoming + ch->led_count);
+    return true;
+}
+
+void ws2812_render_free_channel(ws2812_render_channel_t *ch)
+{
+    free(ch->framebuffer);
+    memset(ch, 0, sizeof(*ch));
+}
+
+bool ws2812_render_is_frame_command(ws2812_command_e type)
+{
+    return type != WS2812_CMD_PIXEL && type != WS2812_CMD_PIXELS && type != WS2812_CMD_BRIGHTNESS &&
+           type != WS2812_CMD_TRANSITION;
+}
+
+void ws2812_render_apply_command(ws2812_render_channel_t *ch, const ws2812_command_t *cmd, int64_t now_us)
+{
+    if (ws2812_render_is_frame_command(cmd->type))
+    {
+        ch->effect = WS2812_EFFECT_NONE;
+        ch->flash_end_us = 0;
+    }
+
+    switch (cmd->type)
+    {
+    case WS2812_CMD_COLOR:
+        ws2812_fill(ch, cmd->color);
+        ch->still.from = ch->still.to = cmd->color;
+        break;
+
+    case WS2812_CMD_OFF: {
+        rgb_color_t off = RGB_COLOR(0, 0, 0);
+        ws2812_fill(ch, off);
+        ch->still.from = ch->still.to = off;
+    }
+    break;
+
+    case WS2812_CMD_PIXEL:
+        if (cmd->pixel.index >= ch->led_count)
+        {
+            return;
+        }
+        ch->framebuffer[cmd->pixel.index] = cmd->pixel.color;
+        break;
+
+    case WS2812_CMD_PIXELS: {
+        if (cmd->pixels.start >= ch->led_count)
+        {
+            return;
+        }
+        uint32_t count = ch->led_count - cmd->pixels.start;
+        count = cmd->pixels.count < count ? cmd->pixels.count : count;
+        memcpy(&ch->framebuffer[cmd->pixels.start], &ch->pixel_staging[cmd->pixels.start], count * sizeof(rgb_color_t));
+    }
+    break;
+
+    case WS2812_CMD_GRADIENT:
+        ws2812_fill_gradient_frame(ch, cmd->gradient.from, cmd->gradient.to);
+        ch->still.from = cmd->gradient.from;
+        ch->still.to = cmd->gradient.to;
+        break;
+
+    case WS2812_CMD_EFFECT:
+        if (ws2812_effect_get(cmd->effect.effect) == NULL)
+        {
+            /* Unknown effect stops the running one and keeps the frame */
+            return;
+        }
+        ch->effect = cmd->effect.effect;
+        ch->effect_params = cmd->effect.params;
+        if (ch->effect_params.period_ms < 2)
+        {
+            ch->effect_params.period_ms = 2;
+        }
+        ws2812_effect_reset_state(&ch->effect_state, ch->led_count);
+        ch->effect_start_us = now_us;
+        ch->effect_pending = true;
+        break;
+
+    case WS2812_CMD_FLASH:
+        ws2812_fill(ch, cmd->flash.color);
+        ch->flash_end_us = now_us + (int64_t)cmd->flash.duration_ms * 1000;
+        break;
+
+    default:
+        return;
+    }
+    ch->framebuffer_changed = true;
+    ch->transition_pending = true;
+}
+
+bool ws2812_render_frame(ws2812_render_channel_t *ch, int64_t now_us)
+{
+    if (ch->flash_end_us != 0 && now_us >= ch->flash_end_us)
+    {
+        rgb_color_t off = RGB_COLOR(0, 0, 0);
+        ws2812_fill(ch, off);
+        ch->flash_end_us = 0;
+        ch->framebuffer_changed = true;
+        ch->transition_pending = true;
+    }
+
+    bool rendered = false;
+    const ws2812_effect_info_t *effect = ws2812_effect_get(ch->effect);
+    if (effect != NULL && (effect->animated || ch->effect_pending))
+    {
+        uint32_t t_ms = (uint32_t)((now_us - ch->effect_start_us) / 1000);
+        effect->render(ch->framebuffer, ch->led_count, t_ms, &ch->effect_params, &ch->effect_state);
+        ch->effect_pending = false;
+        rendered = true;
+        ch->framebuffer_changed = true;
+    }
+
+    if (ch->transition_pending)
+    {
+        ch->transition_pending = false;
+        ws2812_start_transition(ch, now_us);
+    }
+
+    if (ch->framebuffer_changed || ch->transition_active)
+    {
+        ch->framebuffer_changed = false;
+        ws2812_blend_display(ch, now_us);
+        ch->display_dirty = true;
+    }
+    return rendered;
+}
+
+void ws2812_render_compose_output(const ws2812_render_channel_t *ch, rgb_color_t *out)
+{
+    const uint8_t *order = s_color_order_map[ch->config.color_order];
+
+    for (uint32_t i = 0; i < ch->led_count; ++i)
+    {
+        const rgb_color_t *px = &ch->display[i];
+        uint8_t rgb[3] = {s_output_lut[px->color_rgb.red], s_output_lut[px->color_rgb.green],
+                          s_output_lut[px->color_rgb.blue]};
+        /* led_strip sends green, red, blue, so channels are permuted for the other orders */
+        out[i].color_rgb.red = rgb[order[1]];
+        out[i].color_rgb.green = rgb[order[0]];
+        out[i].color_rgb.blue = rgb[order[2]];
+    }
+}
+
+bool ws2812_render_set_brightness(uint8_t brightness)
+{
+    if (brightness == s_brightness)
+    {
+        return false;
+    }
+    ws2812_build_output_lut(brightness);
+    return true;
+}
+
+uint8_t ws2812_render_get_brightness()
+{
+    return s_brightness;
+}
+
+void ws2812_render_set_transition_ms(uint32_t transition_ms)
+{
+    s_transition_ms = transition_ms;
+}
@@ -0,0 +1,244 @@
+#ifndef WS2812_RENDER_H_
+#define WS2812_RENDER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "colors.h"
+#include "ws2812_effects.h"
+
+/* Default strip geometry, used until a configuration is stored in NVS */
+#define WS2812_DEFAULT_GPIO 25
+#define WS2812_DEFAULT_LED_COUNT 15
+#define WS2812_DEFAULT_RESOLUTION_HZ 10000000
+
+/* Limits of the runtime strip configuration */
+#define WS2812_MAX_LED_COUNT 1024
+#define WS2812_MIN_RESOLUTION_HZ 1000000
+#define WS2812_MAX_RESOLUTION_HZ 40000000
+
+/* Render loop runs at fixed 60 FPS, only dirty frames are pushed to the strip */
+#define WS2812_RENDER_FPS 60
+#define WS2812_FRAME_PERIOD_US (1000000 / WS2812_RENDER_FPS)
+
+/* Number of strip channels, each one has its own RMT channel and framebuffer */
+#define WS2812_MAX_CHANNELS 4
+/* Command channel addressing every strip */
+#define WS2812_CHANNEL_ALL 0xFF
+
+/* Default duration of the cross-fade between frames */
+#define WS2812_DEFAULT_TRANSITION_MS 300
+
+/**
+ * @brief Order of the color channels on the wire
+ */
+typedef enum
+{
+    WS2812_ORDER_GRB = 0,
+    WS2812_ORDER_RGB,
+    WS2812_ORDER_BRG,
+    WS2812_ORDER_RBG,
+    WS2812_ORDER_GBR,
+    WS2812_ORDER_BGR,
+    WS2812_ORDER_COUNT
+} ws2812_color_order_e;
+
+/**
+ * @brief Runtime strip geometry of one channel, stored in NVS
+ */
+typedef struct
+{
+    uint16_t led_count;
+    uint8_t gpio;
+    uint8_t color_order; /* ws2812_color_order_e */
+    uint32_t resolution_hz;
+    uint8_t use_dma; /* RMT fed by DMA and the render task not waiting for the push, blocking if DMA is missing */
+} ws2812_strip_config_t;
+
+/**
+ * @brief Lamp commands handled by the render task
+ */
+typedef enum
+{
+    WS2812_CMD_COLOR = 0,
+    WS2812_CMD_OFF,
+    WS2812_CMD_PIXEL,
+    WS2812_CMD_GRADIENT,
+    WS2812_CMD_EFFECT,
+    WS2812_CMD_BRIGHTNESS,
+    WS2812_CMD_FLASH,
+    WS2812_CMD_TRANSITION,
+    WS2812_CMD_PIXELS,
+} ws2812_command_e;
+
+/**
+ * @brief Still frame of a channel as the last solid color or gradient command set it, from equals to for a color
+ */
+typedef struct
+{
+    rgb_color_t from, to;
+} ws2812_still_t;
+
+/**
+ * @brief Structure for the lamp command queue
+ */
+typedef struct
+{
+    ws2812_command_e type;
+    uint8_t channel; /* Channel index or WS2812_CHANNEL_ALL, ignored by brightness and transition */
+    union {
+        rgb_color_t color;
+        uint8_t brightness;
+        uint32_t transition_ms;
+        struct
+        {
+            uint32_t index;
+            rgb_color_t color;
+        } pixel;
+        struct
+        {
+            uint16_t start;
+            uint16_t count;
+        } pixels; /* Range copied from the pixel staging frame of the channel */
+        struct
+        {
+            rgb_color_t from, to;
+        } gradient;
+        struct
+        {
+            ws2812_effect_e effect;
+            ws2812_effect_params_t params;
+        } effect;
+        struct
+        {
+            rgb_color_t color;
+            uint32_t duration_ms;
+        } flash;
+    };
+} ws2812_command_t;
+
+/**
+ * @brief Render state of one strip channel: its frames, transition and effect
+ *
+ * @note The render engine has no RTOS or driver dependencies, time is passed in by the caller, so the same code
+ *       runs in the render task and in the host benchmark.
+ */
+typedef struct
+{
+    ws2812_strip_config_t config;
+    uint32_t led_count;
+
+    /* Per-pixel target framebuffer, commands and effects render into it */
+    rgb_color_t *framebuffer;
+    bool framebuffer_changed;
+
+    /* Displayed frame, cross-faded from transition_start towards framebuffer and pushed when dirty */
+    rgb_color_t *display;
+    bool display_dirty;
+
+    /* Cross-fade state, a new target restarts the fade from the currently displayed frame */
+    rgb_color_t *transition_start;
+    int64_t transition_start_us;
+    bool transition_pending;
+    bool transition_active;
+
+    /* Pixels of dequeued WS2812_CMD_PIXELS commands, the command copies its range into the framebuffer. Senders
+     * stage into pixel_incoming, the two are swapped when the commands are dequeued */
+    rgb_color_t *pixel_staging;
+    rgb_color_t *pixel_incoming;
+
+    /* Last solid color or gradient, single pixel writes are not tracked */
+    ws2812_still_t still;
+
+    /* Pending end of the flash started by WS2812_CMD_FLASH, 0 if none */
+    int64_t flash_end_us;
+
+    /* Running effect, effect_pending renders not animated effects once */
+    ws2812_effect_e effect;
+    ws2812_effect_params_t effect_params;
+    ws2812_effect_state_t effect_state;
+    int64_t effect_start_us;
+    bool effect_pending;
+} ws2812_render_channel_t;
+
+/**
+ * @brief Builds the output LUT, must be called once before the first frame
+ */
+void ws2812_render_init();
+
+/**
+ * @brief Allocates frames of the channel, the config has to be valid
+ *
+ * @param ch channel to be initialized
+ * @param config strip geometry
+ * @return true on success, false if out of memory
+ */
+bool ws2812_render_init_channel(ws2812_render_channel_t *ch, const ws2812_strip_config_t *config);
+
+/**
+ * @brief Frees frames of the channel
+ *
+ * @param ch channel to be released
+ */
+void ws2812_render_free_channel(ws2812_render_channel_t *ch);
+
+/**
+ * @brief Checks if the command repaints the whole frame, so older frame commands can be coalesced
+ *
+ * @param type command type
+ * @return true if the command overrides the whole framebuffer
+ */
+bool ws2812_render_is_frame_command(ws2812_command_e type);
+
+/**
+ * @brief Applies one frame or pixel command to the channel, brightness and transition are ignored
+ *
+ * @param ch strip channel
+ * @param cmd command to be applied
+ * @param now_us current time
+ */
+void ws2812_render_apply_command(ws2812_render_channel_t *ch, const ws2812_command_t *cmd, int64_t now_us);
+
+/**
+ * @brief Advances flash, effect and transition of the channel and blends its displayed frame
+ *
+ * @param ch strip channel
+ * @param now_us current time
+ * @return true if the effect rendered a new frame
+ */
+bool ws2812_render_frame(ws2812_render_channel_t *ch, int64_t now_us);
+
+/**
+ * @brief Composes the output frame from the displayed frame: applies the output LUT and the color order
+ *
+ * @note Output pixels are in led_strip_set_pixel() argument order (red, green, blue fields hold the values
+ *       passed as red, green and blue), so the memory of the frame is the data on the wire.
+ *
+ * @param ch strip channel
+ * @param out output frame of led_count pixels
+ */
+void ws2812_render_compose_output(const ws2812_render_channel_t *ch, rgb_color_t *out);
+
+/**
+ * @brief Sets global brightness and rebuilds the output LUT
+ *
+ * @param brightness brightness in range [0, 255]
+ * @return true if the brightness changed and displayed frames have to be pushed again
+ */
+bool ws2812_render_set_brightness(uint8_t brightness);
+
+/**
+ * @brief Get global brightness
+ *
+ * @return brightness in range [0, 255]
+ */
+uint8_t ws2812_render_get_brightness();
+
+/**
+ * @brief Sets duration of the cross-fade shared by all channels
+ *
+ * @param transition_ms fade duration, 0 switches frames instantly
+ */
+void ws2812_render_set_transition_ms(uint32_t transition_ms);
+
+#endif /* WS2812_RENDER_H_ */
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Generates the C table of gzip-compressed web page assets served by http_server.
+
+Every asset is compressed reproducibly (no file name, mtime 0) and gets a strong ETag derived from the compressed
+content, so the ETag only changes with the content. index.html is served at "/".
+
+Usage: gen_web_assets.py --output web_assets_table.c --dir main/web_page [--immutable NAME ...] NAME [NAME ...]
+"""
+import argparse
+import gzip
+import hashlib
+import io
+import os
+
+MIME_TYPES = {
+    '.css': 'text/css',
+    '.html': 'text/html',
+    '.ico': 'image/x-icon',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.png': 'image/png',
+    '.svg': 'image/svg+xml',
+}
+
+# Versioned files never change under the same name, the others are revalidated with the ETag on every load
+CACHE_IMMUTABLE = 'public, max-age=31536000, immutable'
+CACHE_REVALIDATE = 'no-cache'
+
+
+def compress(data):
+    buffer = io.BytesIO()
+    with gzip.GzipFile(filename='', mode='wb', compresslevel=9, fileobj=buffer, mtime=0) as gz:
+        gz.write(data)
+    return buffer.getvalue()
+
+
+def c_array(name, data):
+    lines = ['static const uint8_t %s[%d] = {' % (name, len(data))]
+    for i in range(0, len(data), 20):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 20]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--output', required=True, help='generated C source')
+    parser.add_argument('--dir', required=True, help='directory of the assets')
+    parser.add_argument('--immutable', action='append', default=[], help='asset cached forever by browsers')
+    parser.add_argument('assets', nargs='+', help='asset file names')
+    args = parser.parse_args()
+
+    arrays = []
+    entries = []
+    for index, name in enumerate(args.assets):
+        extension = os.path.splitext(name)[1]
+        if extension not in MIME_TYPES:
+            parser.error('unknown MIME type of %s' % name)
+        with open(os.path.join(args.dir, name), 'rb') as src:
+            data = compress(src.read())
+
+        symbol = 'web_asset_%d' % index
+        arrays.append('/* %s */\n%s' % (name, c_array(symbol, data)))
+        entries.append('    {\n'
+                       '        .path = "%s",\n'
+                       '        .mime = "%s",\n'
+                       '        .data = %s,\n'
+                       '        .len = sizeof(%s),\n'
+                       '        .etag = "\\"%s\\"",\n'
+                       '        .encoding = "gzip",\n'
+                       '        .cache_control = "%s",\n'
+                       '    },' % ('/' if name == 'index.html' else '/' + name, MIME_TYPES[extension], symbol, symbol,
+                                   hashlib.sha256(data).hexdigest()[:16],
+                                   CACHE_IMMUTABLE if name in args.immutable else CACHE_REVALIDATE))
+
+    source = ('/* Generated by tools/gen_web_assets.py, do not edit */\n'
+              '#include "web_assets.h"\n\n'
+              '%s\n\n'
+              'const web_asset_t web_assets[] = {\n%s\n};\n\n'
+              'const size_t web_assets_count = sizeof(web_assets) / sizeof(web_assets[0]);\n'
+              % ('\n\n'.join(arrays), '\n'.join(entries)))
+
+    # Keep the file untouched if nothing changed, so the firmware is not rebuilt
+    if os.path.exists(args.output):
+        with open(args.output) as old:
+            if old.read() == source:
+                return
+    with open(args.output, 'w') as dst:
+        dst.write(source)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Load test of the web server: N concurrent clients download the same asset and the time to the first and to the
+last byte of every client is reported.
+
+With the asset workers of http_server the clients are served interleaved, so the time to the last byte of the
+fastest and the slowest client are close. Served one after another, it grows linearly with the client index.
+--rate limits the reading speed of every client to simulate slow phones, which must not delay the other clients.
+
+Usage: http_load_test.py [--clients N] [--rounds R] [--rate BYTES_PER_S] [--path /jquery-3.6.1.min.js] HOST[:PORT]
+"""
+import argparse
+import socket
+import statistics
+import threading
+import time
+
+
+def fetch(host, port, path, rate, start, result):
+    request = ('GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip\r\nConnection: close\r\n\r\n' % (path, host))
+    start.wait()
+    t0 = time.monotonic()
+    first_byte = None
+    received = 0
+    try:
+        with socket.create_connection((host, port), timeout=30) as sock:
+            sock.sendall(request.encode())
+            while True:
+                data = sock.recv(1024)
+                if not data:
+                    break
+                now = time.monotonic()
+                if first_byte is None:
+                    first_byte = now - t0
+                received += len(data)
+                if rate:
+                    # Sleep until the received bytes fit the rate limit
+                    delay = t0 + received / rate - time.monotonic()
+                    if delay > 0:
+                        time.sleep(delay)
+    except OSError as e:
+        result['error'] = str(e)
+    result['ttfb'] = first_byte
+    result['ttlb'] = time.monotonic() - t0
+    result['bytes'] = received
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+def report(name, values):
+    print('%-5s min %7.1f  avg %7.1f  p50 %7.1f  p95 %7.1f  max %7.1f ms' %
+          (name, min(values) * 1e3, statistics.mean(values) * 1e3, percentile(values, 50) * 1e3,
+           percentile(values, 95) * 1e3, max(values) * 1e3))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--clients', type=int, default=4, help='concurrent clients')
+    parser.add_argument('--rounds', type=int, default=5, help='number of rounds')
+    parser.add_argument('--rate', type=int, default=0, help='reading speed limit of every client in bytes/s')
+    parser.add_argument('--path', default='/jquery-3.6.1.min.js', help='downloaded path')
+    parser.add_argument('host', help='device address, HOST or HOST:PORT')
+    args = parser.parse_args()
+
+    host, _, port = args.host.partition(':')
+    port = int(port) if port else 80
+
+    results = []
+    for _ in range(args.rounds):
+        start = threading.Event()
+        round_results = [{} for _ in range(args.clients)]
+        threads = [threading.Thread(target=fetch, args=(host, port, args.path, args.rate, start, r))
+                   for r in round_results]
+        for t in threads:
+            t.start()
+        start.set()
+        for t in threads:
+            t.join()
+        results.extend(round_results)
+
+    errors = [r for r in results if 'error' in r or r['ttfb'] is None]
+    ok = [r for r in results if r not in errors]
+    print('%s: %d clients x %d rounds, %d ok, %d failed, %d bytes per response' %
+          (args.path, args.clients, args.rounds, len(ok), len(errors), ok[0]['bytes'] if ok else 0))
+    for r in errors:
+        print('error: %s' % r.get('error', 'no data'))
+    if ok:
+        report('ttfb', [r['ttfb'] for r in ok])
+        report('ttlb', [r['ttlb'] for r in ok])
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Fleet firmware update: serves the image with its manifest and lets every device pull it through /OTApull.
+
+The manifest {"version", "url", "size", "sha256"} is generated from the image, the version is read from the app
+description in the image. Devices download the image from this host, resume a broken download with a Range
+request and skip the update when they run the version already. The tool follows every device through /OTAstatus
+until it runs the new version.
+
+Without devices only the server runs, a stand-in for the update server during tests. --drop-after closes every
+image response after that many bytes, so the devices have to resume. --write-manifest writes the manifest for a
+static server such as nginx, the image has to be next to it then.
+
+Usage: ota_fleet.py [--port PORT] build/UdemyCourse.bin [HOST[:PORT] ...]
+"""
+import argparse
+import hashlib
+import http.client
+import http.server
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+# esp_app_desc_t follows the image header and the first segment header
+APP_DESC_OFFSET = 32
+APP_DESC_MAGIC = 0xABCD5432
+APP_DESC_VERSION_OFFSET = APP_DESC_OFFSET + 16
+APP_DESC_VERSION_SIZE = 32
+
+MANIFEST_PATH = '/manifest.json'
+
+
+def image_version(image):
+    magic, = struct.unpack_from('<I', image, APP_DESC_OFFSET)
+    if image[0] != 0xE9 or magic != APP_DESC_MAGIC:
+        raise ValueError('not an app image')
+    version = image[APP_DESC_VERSION_OFFSET:APP_DESC_VERSION_OFFSET + APP_DESC_VERSION_SIZE]
+    return version.split(b'\0', 1)[0].decode()
+
+
+def make_manifest(image, version, url):
+    return {'version': version, 'url': url, 'size': len(image), 'sha256': hashlib.sha256(image).hexdigest()}
+
+
+class UpdateHandler(http.server.BaseHTTPRequestHandler):
+    """Serves the manifest and the image, the image with single byte ranges"""
+    protocol_version = 'HTTP/1.1'
+
+    def do_GET(self):
+        server = self.server
+        if self.path == MANIFEST_PATH:
+            self.send_body(200, json.dumps(server.manifest).encode(), 'application/json')
+        elif self.path == '/' + server.image_name:
+            self.send_image()
+        else:
+            self.send_body(404, b'not found', 'text/plain')
+
+    def send_body(self, status, body, content_type):
+        self.send_response(status)
+        self.send_header('Content-Type', content_type)
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def send_image(self):
+        image = self.server.image
+        first, status = 0, 200
+        value = self.headers.get('Range', '')
+        if value.startswith('bytes=') and value.endswith('-') and value[6:-1].isdigit():
+            first, status = int(value[6:-1]), 206
+        if first >= len(image):
+            self.send_body(416, b'range not satisfiable', 'text/plain')
+            return
+
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(len(image) - first))
+        if status == 206:
+            self.send_header('Content-Range', 'bytes %d-%d/%d' % (first, len(image) - 1, len(image)))
+        self.end_headers()
+
+        body = memoryview(image)[first:]
+        if self.server.drop_after:
+            body = body[:self.server.drop_after]
+            self.close_connection = True
+        self.wfile.write(body)
+
+    def log_message(self, fmt, *args):
+        sys.stderr.write('server: %s %s\n' % (self.address_string(), fmt % args))
+
+
+def start_server(image, image_name, version, port, drop_after):
+    server = http.server.ThreadingHTTPServer(('', port), UpdateHandler)
+    server.daemon_threads = True
+    server.image = image
+    server.image_name = image_name
+    server.manifest = make_manifest(image, version, image_name)
+    server.drop_after = drop_after
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def request(host, port, method, path, body=None, timeout=10):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request(method, path, body=body)
+        response = conn.getresponse()
+        return response.status, response.read()
+    finally:
+        conn.close()
+
+
+def local_address(host, port):
+    """Address of this host on the network of the device"""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((host, port))
+        return s.getsockname()[0]
+
+
+def update_device(device, manifest_url, version, timeout, results):
+    host, _, port = device.partition(':')
+    port = int(port) if port else 80
+    if manifest_url is None:
+        manifest_url = 'http://%s:%d%s' % (local_address(host, port), results['server_port'], MANIFEST_PATH)
+
+    def done(result):
+        print('%s: %s' % (device, result))
+        results[device] = result
+
+    try:
+        status, data = request(host, port, 'POST', '/OTApull', manifest_url.encode())
+        if status not in (202, 409):
+            return done('failed: /OTApull HTTP %d %s' % (status, data.decode(errors='replace')))
+    except (OSError, http.client.HTTPException) as e:
+        return done('failed: %s' % e)
+    print('%s: pulling %s' % (device, manifest_url))
+
+    deadline = time.monotonic() + timeout
+    last_written = None
+    pulled = False
+    pull = None
+    while time.monotonic() < deadline:
+        time.sleep(1)
+        try:
+            status, data = request(host, port, 'POST', '/OTAstatus')
+            state = json.loads(data)
+        except (OSError, http.client.HTTPException, ValueError):
+            continue  # Restarting into the new image, or a lost request
+        pull = state.get('pull')
+        if pulled or pull == 'done':
+            pulled = True
+            if state.get('version') == version:
+                return done('updated to %s' % version)
+        elif pull == 'up_to_date':
+            return done('up to date, %s' % state.get('version'))
+        elif pull == 'failed':
+            return done('failed, see the device log')
+        else:
+            progress = state.get('progress', {})
+            written = progress.get('written')
+            if written != last_written and progress.get('active'):
+                last_written = written
+                print('%s: %s, %d bytes in flash, %.1f KB/s' %
+                      (device, pull, written, progress.get('rate', 0) / 1024.0))
+    done('timeout, last pull state %s' % ('done' if pulled else pull))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--port', type=int, default=8070, help='port of the update server')
+    parser.add_argument('--version', help='firmware version, read from the image by default')
+    parser.add_argument('--manifest-url', help='manifest of another server, no server is started then')
+    parser.add_argument('--drop-after', type=int, default=0, help='close image responses after this many bytes')
+    parser.add_argument('--timeout', type=int, default=300, help='seconds a device may take')
+    parser.add_argument('--write-manifest', metavar='FILE', help='write the manifest for a static server and exit')
+    parser.add_argument('image', help='firmware image, build/<project>.bin')
+    parser.add_argument('devices', nargs='*', help='device addresses, HOST or HOST:PORT')
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    version = args.version or image_version(image)
+    image_name = os.path.basename(args.image)
+
+    if args.write_manifest:
+        with open(args.write_manifest, 'w') as f:
+            json.dump(make_manifest(image, version, image_name), f)
+        return
+
+    results = {'server_port': args.port}
+    if args.manifest_url is None:
+        start_server(image, image_name, version, args.port, args.drop_after)
+        print('serving %s, version %s, %d bytes on port %d' % (image_name, version, len(image), args.port))
+    if not args.devices:
+        threading.Event().wait()
+
+    threads = [threading.Thread(target=update_device, args=(d, args.manifest_url, version, args.timeout, results))
+               for d in args.devices]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    failed = [d for d in args.devices if not results.get(d, '').startswith(('updated', 'up to date'))]
+    print('%d of %d devices run %s' % (len(args.devices) - len(failed), len(args.devices), version))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
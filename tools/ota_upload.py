@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Resumable firmware upload: the image is sent raw to /OTAupdate in ranges, with its SHA-256 in X-Image-Sha256.
+
+Before every range the device is asked through /OTAresume how much of the image it has in the flash, so after a
+broken connection only the missing part is sent again. The device checks the SHA-256 before it boots the image.
+
+Usage: ota_upload.py [--range BYTES] [--retries N] HOST[:PORT] build/lamp.bin
+"""
+import argparse
+import hashlib
+import http.client
+import json
+import sys
+import time
+
+
+def request(host, port, method, path, headers, body=None, timeout=60):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request(method, path, body=body, headers=headers)
+        response = conn.getresponse()
+        return response.status, response.read()
+    finally:
+        conn.close()
+
+
+def resume_offset(host, port, digest, size):
+    status, data = request(host, port, 'GET', '/OTAresume', {'X-Image-Sha256': digest, 'X-Image-Size': str(size)})
+    if status != 200:
+        raise OSError('/OTAresume: HTTP %d %s' % (status, data.decode(errors='replace')))
+    return json.loads(data)['offset']
+
+
+def upload(host, port, image, range_size, retries):
+    digest = hashlib.sha256(image).hexdigest()
+    size = len(image)
+    print('%s: %d bytes, sha256 %s' % (host, size, digest))
+
+    failures = 0
+    sent = 0
+    t0 = time.monotonic()
+    while True:
+        try:
+            offset = resume_offset(host, port, digest, size)
+            last = min(offset + range_size, size) - 1
+            headers = {
+                'Content-Type': 'application/octet-stream',
+                'X-Image-Sha256': digest,
+                'Content-Range': 'bytes %d-%d/%d' % (offset, last, size),
+            }
+            status, data = request(host, port, 'POST', '/OTAupdate', headers, image[offset:last + 1])
+            if status not in (200, 416):
+                raise OSError('/OTAupdate: HTTP %d %s' % (status, data.decode(errors='replace')))
+            sent += last + 1 - offset
+            reply = json.loads(data)
+            print('%s: %d of %d bytes in flash' % (host, reply['offset'], size))
+            if reply['done']:
+                break
+        except (OSError, http.client.HTTPException, ValueError, KeyError) as e:
+            failures += 1
+            if failures > retries:
+                print('%s: giving up: %s' % (host, e))
+                return False
+            print('%s: %s, retrying (%d/%d)' % (host, e, failures, retries))
+            time.sleep(min(2 ** failures, 30))
+
+    elapsed = time.monotonic() - t0
+    print('%s: done in %.1f s, %d bytes sent for a %d byte image, %.1f KB/s' %
+          (host, elapsed, sent, size, sent / 1024.0 / elapsed))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--range', type=int, default=256 * 1024, help='image bytes per request')
+    parser.add_argument('--retries', type=int, default=10, help='failed requests before giving up')
+    parser.add_argument('host', help='device address, HOST or HOST:PORT')
+    parser.add_argument('image', help='firmware image, build/<project>.bin')
+    args = parser.parse_args()
+
+    host, _, port = args.host.partition(':')
+    port = int(port) if port else 80
+    with open(args.image, 'rb') as f:
+        image = f.read()
+    sys.exit(0 if upload(host, port, image, args.range, args.retries) else 1)
+
+
+if __name__ == '__main__':
+    main()